@@ -0,0 +1,229 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared sensor acquisition core
+ * Common start / poll interface for every bus driver, one core that
+ * schedules the reads, averages them and sends them over the UART
+ * 
+ * Acq_Run and Acq_Emit take no argument so they can be rate scheduler
+ * jobs. The output line is built with integer formatting and sent with
+ * one call, sprintf is only used for the report.
+ * 
+ * ========================================
+*/
+#include "acq.h"
+#include "systime.h"
+#include "stdio.h"
+
+#define FALSE  0
+#define TRUE   1
+/* Longest output line */
+#define ACQ_LINE_SIZE 192
+/* Room for a field besides its name: " , ", " :", sign, 10 digits,
+ * point and 4 decimals */
+#define ACQ_FIELD_SIZE 21
+/* Line end: " }\r\n" and the NUL */
+#define ACQ_TAIL_SIZE 5
+
+static Sensor *table;
+static uint8 tableCount;
+static void (*output)(const char *s);
+/* Flags used to store transmit data commands */
+static uint8 ContinuouslySendData = FALSE;
+static uint8 SendSingleByte = FALSE;
+
+/* Subprocesses */
+/* Take over a sensor table, the first read of each sensor is due now */
+void Acq_Init(Sensor *sensors, uint8 count, void (*out)(const char *s))
+{
+    uint32 now = SysTime_Us();
+    Sensor *s;
+
+    table = sensors;
+    tableCount = count;
+    output = out;
+    for (s = sensors; s < sensors + count; s++)
+    {
+        s->next = now;
+        s->busy = FALSE;
+        s->sum = 0;
+        s->cnt = 0u;
+        s->reads = 0u;
+        s->errors = 0u;
+        s->overruns = 0u;
+    }
+}
+/* Poll the running reads and start the ones that are due */
+void Acq_Run(void)
+{
+    uint32 now = SysTime_Us();
+    Sensor *s;
+    int r;
+
+    for (s = table; s < table + tableCount; s++)
+    {
+        if (s->busy)
+        {
+            r = s->ops->poll(s);
+            if (r != SENSOR_BUSY)
+            {
+                s->busy = FALSE;
+                if (r == SENSOR_READY)
+                {
+                    s->stamp = SysTime_Us();
+                    s->sum += s->value;
+                    s->cnt++;
+                    s->reads++;
+                }
+                else if (r == SENSOR_ERROR) s->errors++;
+            }
+        }
+        if (SysTime_Diff(now, s->next) < 0) continue;
+
+        /* Next read one period on, or one period from now if we fell behind */
+        s->next += s->periodUs;
+        if (SysTime_Diff(now, s->next) >= 0) s->next = now + s->periodUs;
+        if (s->busy) s->overruns++;
+        else
+        {
+            r = s->ops->start(s);
+            if (r == 0) s->busy = TRUE;
+            else if (r == SENSOR_ERROR) s->errors++;
+        }
+    }
+}
+/* Write value (frac fractional bits) with the given decimals, rounded.
+ * Return the end of the text. */
+char *Acq_FormatFixed(char *p, int32 value, uint8 frac, uint8 decimals)
+{
+    static const uint32 pow10[] = { 1u, 10u, 100u, 1000u, 10000u };
+    char digits[10];
+    uint32 mag, ip, fp, scale;
+    int n = 0;
+
+    if (decimals > 4u) decimals = 4u;
+    scale = pow10[decimals];
+    mag = value < 0 ? (uint32)(-value) : (uint32)value;
+    ip = mag >> frac;
+    /* Fraction in decimal, rounded half up */
+    fp = frac ? ((mag & ((1u << frac) - 1u)) * scale + (1u << (frac - 1u))) >> frac : 0u;
+    if (fp >= scale)
+    {
+        fp -= scale;
+        ip++;
+    }
+    if (value < 0 && (ip || fp)) *p++ = '-';
+    do
+    {
+        digits[n++] = (char)('0' + ip % 10u);
+        ip /= 10u;
+    } while (ip);
+    while (n) *p++ = digits[--n];
+    if (decimals)
+    {
+        *p++ = '.';
+        for (n = decimals; n; n--)
+        {
+            scale /= 10u;
+            *p++ = (char)('0' + fp / scale % 10u);
+        }
+    }
+    return p;
+}
+/* End of an output window: send the mean of every sensor that was read
+ * if requested, then start a new window.
+ * The line is { name :value , name :value }, fields that do not fit
+ * are left out. */
+void Acq_Emit(void)
+{
+    char line[ACQ_LINE_SIZE];
+    char *p = line;
+    /* Fields end here, the tail always fits after them */
+    char *end = line + ACQ_LINE_SIZE - ACQ_TAIL_SIZE;
+    const char *q;
+    uint8 first = TRUE;
+    Sensor *s;
+
+    if (SendSingleByte || ContinuouslySendData)
+    {
+        *p++ = '{';
+        for (s = table; s < table + tableCount; s++)
+        {
+            if (s->cnt == 0u) continue;
+            if (p + ACQ_FIELD_SIZE > end) break;
+            *p++ = ' ';
+            if (!first)
+            {
+                *p++ = ',';
+                *p++ = ' ';
+            }
+            first = FALSE;
+            /* The name is cut to leave room for " :" and the value */
+            for (q = s->name; *q && p < end - (ACQ_FIELD_SIZE - 3); ) *p++ = *q++;
+            *p++ = ' ';
+            *p++ = ':';
+            p = Acq_FormatFixed(p, s->latest ? s->value : s->sum / (int32)s->cnt, s->frac, s->decimals);
+        }
+        *p++ = ' ';
+        *p++ = '}';
+        *p++ = '\r';
+        *p++ = '\n';
+        *p = '\0';
+        output(line);
+        /* Reset the send once flag */
+        SendSingleByte = FALSE;
+    }
+    for (s = table; s < table + tableCount; s++)
+    {
+        s->sum = 0;
+        s->cnt = 0u;
+    }
+}
+/* Handle the common UART commands, return 1 if ch was one of them.
+ *  On 'C' or 'c' received: transmits the next window.
+ *  On 'S' or 's' received: continuously transmits every window.
+ *  On 'X' or 'x' received: stops continuously transmitting. */
+int Acq_Command(uint8 ch)
+{
+    switch(ch)
+    {
+        case 'C':
+        case 'c':
+            SendSingleByte = TRUE;
+            return TRUE;
+        case 'S':
+        case 's':
+            ContinuouslySendData = TRUE;
+            return TRUE;
+        case 'X':
+        case 'x':
+            ContinuouslySendData = FALSE;
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+/* Print reads, errors, overruns and the last value of every sensor in use */
+void Acq_Report(void)
+{
+    char buf[80];
+    char *p;
+    Sensor *s;
+
+    for (s = table; s < table + tableCount; s++)
+    {
+        if (s->reads == 0u && s->errors == 0u) continue;
+        p = buf + sprintf(buf, "%-12s %8lu reads %6lu err %6lu over, last ", s->name,
+                          s->reads, s->errors, s->overruns);
+        p = Acq_FormatFixed(p, s->value, s->frac, s->decimals);
+        sprintf(p, " at %lu us\r\n", s->stamp);
+        output(buf);
+    }
+}
+
+/* [] END OF FILE */
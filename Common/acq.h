@@ -0,0 +1,68 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared sensor acquisition core
+ * Common start / poll interface for every bus driver, one core that
+ * schedules the reads, averages them and sends them over the UART
+ * 
+ * ========================================
+*/
+#ifndef ACQ_H
+#define ACQ_H
+
+#include <project.h>
+
+/* Poll results */
+#define SENSOR_BUSY     0
+#define SENSOR_READY    1   /* value holds a new reading */
+#define SENSOR_ERROR    2
+#define SENSOR_ABSENT   3   /* nothing to read, not counted as an error */
+
+typedef struct Sensor Sensor;
+
+/* Bus driver. start begins a reading and returns 0, or SENSOR_ERROR /
+ * SENSOR_ABSENT. poll is called on every core pass until it returns
+ * something other than SENSOR_BUSY, it must not block. */
+typedef struct
+{
+    int (*start)(Sensor *s);
+    int (*poll)(Sensor *s);
+} SensorOps;
+
+struct Sensor
+{
+    const char *name;
+    const SensorOps *ops;
+    int arg;            /* driver argument: channel, device index */
+    uint32 periodUs;    /* time between reads */
+    uint8 frac;         /* fractional bits of value */
+    uint8 decimals;     /* decimals sent */
+    uint8 latest;       /* 1 sends the last reading instead of the window mean */
+    /* Set by the driver before it returns SENSOR_READY */
+    int32 value;
+    /* Kept by the core */
+    uint32 stamp;       /* SysTime_Us of the last reading */
+    uint32 next;
+    uint8 busy;
+    int32 sum;          /* readings in the current output window */
+    uint32 cnt;
+    uint32 reads;
+    uint32 errors;
+    uint32 overruns;    /* reads skipped because the last one was still running */
+};
+
+void Acq_Init(Sensor *sensors, uint8 count, void (*out)(const char *s));
+void Acq_Run(void);
+void Acq_Emit(void);
+int Acq_Command(uint8 ch);
+void Acq_Report(void);
+char *Acq_FormatFixed(char *p, int32 value, uint8 frac, uint8 decimals);
+
+#endif /* ACQ_H */
+
+/* [] END OF FILE */
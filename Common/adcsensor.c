@@ -0,0 +1,79 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared ADC_DelSig_1 sensor driver for the acquisition core
+ * 
+ * The ADC converts continuously and every ADC sensor shares its
+ * conversions: the first read after an end of conversion takes the
+ * result for all of them, and each sensor, by its argument, keeps
+ * the number of the conversion it read last so it gets every new
+ * result once.
+ * 
+ * ========================================
+*/
+#include "adcsensor.h"
+
+/* Latest conversion and the number of conversions so far */
+static int32 lastMv;
+static uint32 conversions = 0u;
+/* Conversion each sensor was last read from */
+static uint32 readCount[ADC_SENSOR_MAX];
+
+/* Start the ADC and the continuous conversion */
+void AdcSensor_Start(void)
+{
+    ADC_DelSig_1_Start();
+    ADC_DelSig_1_StartConvert();
+}
+
+/* Nothing to start, the ADC is free running */
+static int AdcStart(Sensor *s)
+{
+    if ((uint32)s->arg >= ADC_SENSOR_MAX) return SENSOR_ERROR;
+    return 0;
+}
+/* Latest conversion in mV, 0 if s has read it already. The end of
+ * conversion flag clears when it is read, so it is taken once here for
+ * every sensor. */
+static int AdcReady(Sensor *s, int32 *mV)
+{
+    /* Use the GetResult16 API to get an 8 bit unsigned result in
+     * single ended mode.  The API CountsTo_mVolts is then used
+     * to convert the ADC counts into mV */
+    if (ADC_DelSig_1_IsEndConversion(ADC_DelSig_1_RETURN_STATUS))
+    {
+        lastMv = ADC_DelSig_1_CountsTo_mVolts(ADC_DelSig_1_GetResult16());
+        conversions++;
+    }
+    if (readCount[s->arg] == conversions) return 0;
+    readCount[s->arg] = conversions;
+    *mV = lastMv;
+    return 1;
+}
+static int AdcPoll_mV(Sensor *s)
+{
+    int32 mV;
+
+    if (!AdcReady(s, &mV)) return SENSOR_BUSY;
+    s->value = mV << ADC_SENSOR_FRAC;
+    return SENSOR_READY;
+}
+static int AdcPoll_Temp(Sensor *s)
+{
+    int32 mV;
+
+    if (!AdcReady(s, &mV)) return SENSOR_BUSY;
+    /* The conversion of ADC value to temperature for this sensor is 10mV = 1 degree Celcius */
+    s->value = (mV << ADC_SENSOR_FRAC) / 10;
+    return SENSOR_READY;
+}
+
+const SensorOps AdcSensor_mV = { AdcStart, AdcPoll_mV };
+const SensorOps AdcSensor_Temp = { AdcStart, AdcPoll_Temp };
+
+/* [] END OF FILE */
@@ -0,0 +1,32 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared ADC_DelSig_1 sensor driver for the acquisition core
+ * 
+ * ========================================
+*/
+#ifndef ADCSENSOR_H
+#define ADCSENSOR_H
+
+#include "acq.h"
+
+/* Q4 fixed point, 1/16 of the unit */
+#define ADC_SENSOR_FRAC 4
+/* Sensors sharing the conversions, the argument of each is its index */
+#define ADC_SENSOR_MAX  4
+
+/* Input in mV */
+extern const SensorOps AdcSensor_mV;
+/* Analog temperature sensor, 10 mV per degree Celsius */
+extern const SensorOps AdcSensor_Temp;
+
+void AdcSensor_Start(void);
+
+#endif /* ADCSENSOR_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,71 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared single pin access
+ * Reads and writes one pin of a Pins component through its bit-band
+ * alias, one load or store instead of the read-modify-write of the port
+ *
+ * The generated <Pin>_Write reads the port data register, masks and
+ * writes it back. An interrupt that writes another pin of the same port
+ * in between has its write undone, and the call costs a branch and some
+ * ten instructions. The Cortex-M3 maps every bit of the peripheral
+ * region to a word of its own in the alias region: a store to the alias
+ * sets or clears that bit alone, in one locked bus transfer. The alias
+ * addresses are worked out by the compiler from the <Pin>__DR, __PS and
+ * __SHIFT macros of cyfitter.h, so the pin name is all that is given.
+ *
+ * Single bit Pins components only, the first pin of a wider one.
+ *
+ * ========================================
+*/
+#ifndef BITPIN_H
+#define BITPIN_H
+
+#include <project.h>
+
+#if defined(BITPIN_HOST)
+
+/* Host builds have no port registers, the pins stay functions */
+#define BitPin_Write(pin, value)    pin##_Write((uint8)(value))
+#define BitPin_Read(pin)            pin##_Read()
+#define BitPin_Latch(pin)           pin##_Read()
+#define BitPin_Toggle(pin)          pin##_Write((uint8)!pin##_Read())
+#define BITPIN_CHECK(pin)           typedef char BitPin_##pin##_Ok
+
+#else
+
+/* Peripheral bit-band region and its alias */
+#define BITPIN_PERIPH       0x40000000u
+#define BITPIN_PERIPH_SIZE  0x00100000u
+#define BITPIN_ALIAS        0x42000000u
+
+/* Alias of bit in the register at addr */
+#define BITPIN_ADDR(addr, bit)  (BITPIN_ALIAS + (((uint32)(addr) - BITPIN_PERIPH) << 5) + ((uint32)(bit) << 2))
+/* Byte access, the bus does a byte read-modify-write of the register */
+#define BITPIN_REG(addr, bit)   (*(reg8 *)BITPIN_ADDR(addr, bit))
+
+/* Drive the output latch, 0 or 1 */
+#define BitPin_Write(pin, value)    (BITPIN_REG(pin##__DR, pin##__SHIFT) = (uint8)(value))
+/* Pin state, what the pin is at */
+#define BitPin_Read(pin)            (BITPIN_REG(pin##__PS, pin##__SHIFT))
+/* Output latch, what the pin is driven to */
+#define BitPin_Latch(pin)           (BITPIN_REG(pin##__DR, pin##__SHIFT))
+/* Invert the output latch. A load and a store: only an interrupt that
+ * writes this same pin in between can be lost, not the other pins. */
+#define BitPin_Toggle(pin)          (BitPin_Latch(pin) ^= 1u)
+
+/* Stops the build if a pin is placed outside the bit-band region, once
+ * per pin at file scope */
+#define BITPIN_CHECK(pin)   typedef char BitPin_##pin##_Ok[((uint32)(pin##__DR) - BITPIN_PERIPH < BITPIN_PERIPH_SIZE && \
+                                                             (uint32)(pin##__PS) - BITPIN_PERIPH < BITPIN_PERIPH_SIZE) ? 1 : -1]
+
+#endif /* BITPIN_HOST */
+
+#endif /* BITPIN_H */
+
+/* [] END OF FILE */
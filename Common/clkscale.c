@@ -0,0 +1,154 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared clock scaling
+ * Switches the bus clock at run time and re-derives everything that
+ * counts it: delays, SysTime, flash wait states and divided clocks
+ *
+ * Everything generated for the DWR clock is fixed at 24 MHz: CyDelay,
+ * the SysTick reload and the divider of every clock component. A level
+ * change redoes all of them with interrupts disabled, so no interrupt
+ * sees a bus clock that does not match its dividers. The PLL relocks on
+ * every change to or between PLL levels, up to 250 us with interrupts
+ * off, so change levels at most a few times a second.
+ *
+ * The dividers of every level are worked out once in ClkScale_Init. A
+ * level that would put a registered clock off by more than CLK_TOLERANCE
+ * is refused, the UART baud rates rule out most low clocks.
+ *
+ * ========================================
+*/
+#include "clkscale.h"
+#include "systime.h"
+
+/* Registered clocks at most */
+#define CLK_MAX_CLOCKS  8u
+/* PLL charge pump current, as in the DWR, uA */
+#define CLK_PLL_CURRENT 2u
+
+/* Bus clock, IMO frequency and PLL P and Q, P 0 runs from the IMO */
+typedef struct
+{
+    uint32 hz;
+    uint8 imo;
+    uint8 p;
+    uint8 q;
+} ClkLevel;
+
+static const ClkLevel levels[CLK_LEVELS] =
+{
+    { 12000000u, CY_IMO_FREQ_12MHZ, 0u, 0u },
+    { 24000000u, CY_IMO_FREQ_3MHZ, 8u, 1u },
+    { 48000000u, CY_IMO_FREQ_3MHZ, 16u, 1u },
+};
+
+static ScaledClock *table;
+static uint8 tableCount;
+/* Divider register of every clock at every level */
+static uint16 dividers[CLK_MAX_CLOCKS][CLK_LEVELS];
+/* Levels every clock can follow, one bit each */
+static uint8 allowed;
+static uint8 current = CLK_NORMAL;
+
+/* Subprocesses */
+/* Take over the divided clocks, the bus clock is the DWR one */
+void ClkScale_Init(ScaledClock *clocks, uint8 count)
+{
+    uint32 hz, err;
+    uint16 div;
+    uint8 i, level;
+
+    table = clocks;
+    tableCount = count < CLK_MAX_CLOCKS ? count : CLK_MAX_CLOCKS;
+    current = CLK_NORMAL;
+    allowed = (1u << CLK_LEVELS) - 1u;
+    for (i = 0u; i < tableCount; i++)
+    {
+        table[i].hz = BCLK__BUS_CLK__HZ / ((uint32)table[i].get() + 1u);
+        for (level = 0u; level < CLK_LEVELS; level++)
+        {
+            /* Nearest divider, and how far off it leaves the clock */
+            hz = (levels[level].hz + table[i].hz / 2u) / table[i].hz;
+            if (hz < 1u) hz = 1u;
+            if (hz > 65536u) hz = 65536u;
+            div = (uint16)(hz - 1u);
+            hz = levels[level].hz / hz;
+            err = hz > table[i].hz ? hz - table[i].hz : table[i].hz - hz;
+            if (err * 1000u > table[i].hz * CLK_TOLERANCE) allowed &= (uint8)~(1u << level);
+            dividers[i][level] = div;
+        }
+    }
+}
+/* Switch the bus clock to level. Return 1 if a registered clock can not
+ * follow, nothing changes then. */
+uint8 ClkScale_Set(uint8 level)
+{
+    const ClkLevel *to;
+    uint8 intState, i;
+
+    if (level >= CLK_LEVELS || !(allowed & (1u << level))) return 1u;
+    if (level == current) return 0u;
+    to = &levels[level];
+
+    intState = CyEnterCriticalSection();
+    /* Wait states for the faster of the two while the clock changes */
+    CyFlash_SetWaitCycles((uint8)((to->hz > levels[current].hz ? to->hz : levels[current].hz) / 1000000u));
+    /* The master clock leaves the PLL before it stops */
+    CyMasterClk_SetSource(CY_MASTER_SOURCE_IMO);
+    CyPLL_OUT_Stop();
+    CyIMO_SetFreq(to->imo);
+    if (to->p)
+    {
+        CyPLL_OUT_SetPQ(to->p, to->q, CLK_PLL_CURRENT);
+        if (CyPLL_OUT_Start(1u) == CYRET_SUCCESS)
+        {
+            CyMasterClk_SetSource(CY_MASTER_SOURCE_PLL);
+        }
+        else
+        {
+            /* No lock: carry on from the IMO alone */
+            CyPLL_OUT_Stop();
+            CyIMO_SetFreq(levels[CLK_LOW].imo);
+            level = CLK_LOW;
+            to = &levels[CLK_LOW];
+        }
+    }
+    CyFlash_SetWaitCycles((uint8)(to->hz / 1000000u));
+
+    /* Everything that counts the bus clock */
+    CyDelayFreq(to->hz);
+    SysTime_SetClock(to->hz);
+    for (i = 0u; i < tableCount; i++) table[i].set(dividers[i][level], 0u);
+    current = level;
+    CyExitCriticalSection(intState);
+    return 0u;
+}
+/* One level up when the CPU is busy, one down when it mostly sleeps.
+ * Call it now and then with the awake share since the last call. */
+void ClkScale_Govern(uint16 awakePermille)
+{
+    if (awakePermille > CLK_GOV_UP && current + 1u < CLK_LEVELS)
+    {
+        (void) ClkScale_Set(current + 1u);
+    }
+    else if (awakePermille < CLK_GOV_DOWN && current > 0u)
+    {
+        (void) ClkScale_Set(current - 1u);
+    }
+}
+uint8 ClkScale_Level(void)
+{
+    return current;
+}
+/* Bus clock now */
+uint32 ClkScale_Hz(void)
+{
+    return levels[current].hz;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,50 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared clock scaling
+ * Switches the bus clock at run time and re-derives everything that
+ * counts it: delays, SysTime, flash wait states and divided clocks
+ *
+ * ========================================
+*/
+#ifndef CLKSCALE_H
+#define CLKSCALE_H
+
+#include <project.h>
+
+/* Bus clock levels, the PLL runs from the 3 MHz IMO */
+#define CLK_LOW         0u  /* 12 MHz, IMO without the PLL */
+#define CLK_NORMAL      1u  /* 24 MHz, the DWR setting */
+#define CLK_HIGH        2u  /* 48 MHz */
+#define CLK_LEVELS      3u
+/* Largest error a divided clock may get from a new level, permille */
+#define CLK_TOLERANCE   20u
+/* Governor: awake permille above which to go up a level, below which
+ * to go down, far enough apart that a level change can not undo itself */
+#define CLK_GOV_UP      600u
+#define CLK_GOV_DOWN    200u
+
+/* A clock divided from the bus clock, such as a UART or PWM clock,
+ * that keeps its frequency across levels. Give the generated
+ * <Clock>_SetDividerRegister and _GetDividerRegister. */
+typedef struct
+{
+    void (*set)(uint16 clkDivider, uint8 restart);
+    uint16 (*get)(void);
+    uint32 hz;                  /* kept by ClkScale */
+} ScaledClock;
+
+void ClkScale_Init(ScaledClock *clocks, uint8 count);
+uint8 ClkScale_Set(uint8 level);
+void ClkScale_Govern(uint16 awakePermille);
+uint8 ClkScale_Level(void);
+uint32 ClkScale_Hz(void);
+
+#endif /* CLKSCALE_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,178 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared cooperative scheduler
+ * Run-to-completion tasks that sleep on SysTime deadlines or wait for
+ * a signal instead of spinning in CyDelay
+ *
+ * Every task runs to the end of its function and says what it waits
+ * for before it returns, so one stack serves all of them and a task
+ * never sees another one half way. A pass in which no task was due is
+ * idle time, Coop_Load keeps how much of it there was.
+ *
+ * ========================================
+*/
+#include "coop.h"
+#include "systime.h"
+#include "stdio.h"
+#include "string.h"
+
+CoopLoad Coop_Load;
+
+static CoopTask *table;
+static uint8 tableCount;
+/* Task being run and when it started */
+static CoopTask *current;
+static uint32 runStart;
+
+/* Subprocesses */
+/* Take over a task table, every task runs on the first pass */
+void Coop_Init(CoopTask *tasks, uint8 count)
+{
+    CoopTask *t;
+
+    table = tasks;
+    tableCount = count;
+    for (t = tasks; t < tasks + count; t++)
+    {
+        t->state = COOP_READY;
+        t->signaled = 0u;
+        t->runs = 0u;
+        t->runMax = 0u;
+        t->latencyMax = 0u;
+        t->latencySum = 0u;
+    }
+    Coop_ResetLoad();
+}
+/* One pass over the table, runs every task that is due in table order.
+ * Call it forever from main. Return the number of tasks run. */
+uint8 Coop_Run(void)
+{
+    uint32 start = SysTime_Us(), now, ready, dt;
+    uint8 ran = 0u;
+    CoopTask *t;
+
+    for (t = table; t < table + tableCount; t++)
+    {
+        now = SysTime_Us();
+        if (t->state == COOP_SLEEP)
+        {
+            if (SysTime_Diff(now, t->wake) < 0) continue;
+            ready = t->wake;
+        }
+        else if (t->state == COOP_WAIT)
+        {
+            if (!t->signaled) continue;
+            ready = t->signalAt;
+        }
+        else ready = now;
+
+        /* Read after ready: a signal from an interrupt since the first
+         * read would be stamped after it and make dt wrap */
+        now = SysTime_Us();
+        /* How long the task was due before it got the CPU */
+        dt = now - ready;
+        if (dt > t->latencyMax) t->latencyMax = dt;
+        t->latencySum += dt;
+        /* Signals from here on are for the next run */
+        t->signaled = 0u;
+        t->state = COOP_READY;
+        current = t;
+        runStart = now;
+        t->run();
+        dt = SysTime_Us() - now;
+        if (dt > t->runMax) t->runMax = dt;
+        t->runs++;
+        ran++;
+    }
+    current = NULL;
+
+    dt = SysTime_Us() - start;
+    Coop_Load.passes++;
+    Coop_Load.totalUs += dt;
+    if (!ran) Coop_Load.idleUs += dt;
+    if (dt > Coop_Load.passMax) Coop_Load.passMax = dt;
+    return ran;
+}
+/* Run the current task again us after it started this time */
+void Coop_Sleep(uint32 us)
+{
+    Coop_SleepUntil(runStart + us);
+}
+/* Run the current task again at the SysTime_Us time stamp us */
+void Coop_SleepUntil(uint32 us)
+{
+    if (current == NULL) return;
+    current->wake = us;
+    current->state = COOP_SLEEP;
+}
+/* Run the current task again when it is signaled. A signal that came
+ * while it ran counts. */
+void Coop_Wait(void)
+{
+    if (current == NULL) return;
+    current->state = COOP_WAIT;
+}
+/* Make a waiting task due, safe to call from interrupts */
+void Coop_Signal(CoopTask *task)
+{
+    if (!task->signaled) task->signalAt = SysTime_Us();
+    task->signaled = 1u;
+}
+/* Microseconds until the next task is due, 0 if one is due now and
+ * COOP_FOREVER if every task waits for a signal. Call it with interrupts
+ * disabled to sleep on the answer, a signal can not come in between. */
+int32 Coop_IdleUs(void)
+{
+    uint32 now = SysTime_Us();
+    int32 next = COOP_FOREVER, dt;
+    CoopTask *t;
+
+    for (t = table; t < table + tableCount; t++)
+    {
+        if (t->state == COOP_SLEEP) dt = SysTime_Diff(t->wake, now);
+        else if (t->state == COOP_WAIT) dt = t->signaled ? 0 : COOP_FOREVER;
+        else dt = 0;
+        if (dt <= 0) return 0;
+        if (dt < next) next = dt;
+    }
+    return next;
+}
+/* Share of the time since the last report that no task was due */
+uint16 Coop_IdlePermille(void)
+{
+    uint32 total = Coop_Load.totalUs / 1000u;
+
+    return total ? (uint16)(Coop_Load.idleUs / total) : 0u;
+}
+/* Print runs, longest run and latency of every task, then the idle
+ * share and longest pass, and start a new measurement window */
+void Coop_Report(void (*out)(const char *s))
+{
+    char buf[72];
+    CoopTask *t;
+    uint16 idle = Coop_IdlePermille();
+
+    for (t = table; t < table + tableCount; t++)
+    {
+        sprintf(buf, "%-8s %8lu runs %6lu us run %6lu/%6lu us latency\r\n", t->name,
+                t->runs, t->runMax, t->runs ? t->latencySum / t->runs : 0u, t->latencyMax);
+        out(buf);
+    }
+    sprintf(buf, "idle %u.%u %%, longest pass %lu us\r\n", idle / 10u, idle % 10u,
+            Coop_Load.passMax);
+    out(buf);
+    Coop_ResetLoad();
+}
+/* Start a new measurement window */
+void Coop_ResetLoad(void)
+{
+    memset(&Coop_Load, 0, sizeof(Coop_Load));
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,70 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared cooperative scheduler
+ * Run-to-completion tasks that sleep on SysTime deadlines or wait for
+ * a signal instead of spinning in CyDelay
+ *
+ * ========================================
+*/
+#ifndef COOP_H
+#define COOP_H
+
+#include <project.h>
+
+/* Task states */
+#define COOP_READY      0u  /* runs on every pass */
+#define COOP_SLEEP      1u  /* runs once wake has passed */
+#define COOP_WAIT       2u  /* runs once signaled */
+/* Coop_IdleUs when every task waits for a signal */
+#define COOP_FOREVER    0x7FFFFFFFl
+
+/* One task. name and run are set by the user, the rest is kept by the
+ * scheduler. A task that neither sleeps nor waits runs again on the
+ * next pass. */
+typedef struct
+{
+    const char *name;
+    void (*run)(void);
+    /* Scheduler state */
+    uint8 state;
+    uint32 wake;                /* us */
+    volatile uint8 signaled;
+    volatile uint32 signalAt;   /* us, first signal since the last run */
+    /* Statistics */
+    uint32 runs;
+    uint32 runMax;              /* longest run, us */
+    uint32 latencyMax;          /* longest delay from ready to running, us */
+    uint32 latencySum;
+} CoopTask;
+
+/* Whole main loop */
+typedef struct
+{
+    uint32 passes;
+    uint32 totalUs;
+    uint32 idleUs;              /* time in passes that ran no task */
+    uint32 passMax;             /* longest pass, the worst wait for any task */
+} CoopLoad;
+
+extern CoopLoad Coop_Load;
+
+void Coop_Init(CoopTask *tasks, uint8 count);
+uint8 Coop_Run(void);
+void Coop_Sleep(uint32 us);
+void Coop_SleepUntil(uint32 us);
+void Coop_Wait(void);
+void Coop_Signal(CoopTask *task);
+int32 Coop_IdleUs(void);
+uint16 Coop_IdlePermille(void);
+void Coop_ResetLoad(void);
+void Coop_Report(void (*out)(const char *s));
+
+#endif /* COOP_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,53 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared CRC-8 routines
+ * Dallas/Maxim (1-Wire) checksum
+ * 
+ * ========================================
+*/
+#ifndef CRC8_H
+#define CRC8_H
+
+#include "cytypes.h"
+
+/* Lookup methods, select one with CRC8_METHOD */
+#define CRC8_TABLE   0  /* 256-entry table, one lookup per byte */
+#define CRC8_NIBBLE  1  /* 16-entry table, two lookups per byte, least flash */
+#define CRC8_SLICE4  2  /* 4x256-entry table, four bytes per step */
+
+#ifndef CRC8_METHOD
+#define CRC8_METHOD CRC8_TABLE
+#endif
+
+/* Lookup tables, kept in flash */
+extern const uint8 Crc8DallasTable[256];
+extern const uint8 Crc8DallasNibbleTable[16];
+extern const uint8 Crc8DallasSliceTable[4][256];
+
+/* Add one byte to a running Dallas/Maxim CRC */
+#define CRC8_DALLAS_UPDATE(crc, b)  (Crc8DallasTable[(uint8)((crc) ^ (b))])
+
+/* Dallas/Maxim CRC-8 (x^8 + x^5 + x^4 + 1, LSB first), used by 1-Wire.
+ * crc is the start value, 0 for a new ROM or scratchpad. */
+uint8 Crc8DallasTbl(const uint8 *buf, uint32 len, uint8 crc);
+uint8 Crc8DallasNib(const uint8 *buf, uint32 len, uint8 crc);
+uint8 Crc8DallasSlice4(const uint8 *buf, uint32 len, uint8 crc);
+
+/* Default routines for the selected method */
+#if (CRC8_METHOD == CRC8_NIBBLE)
+    #define Crc8Dallas  Crc8DallasNib
+#elif (CRC8_METHOD == CRC8_SLICE4)
+    #define Crc8Dallas  Crc8DallasSlice4
+#else
+    #define Crc8Dallas  Crc8DallasTbl
+#endif
+
+#endif /* CRC8_H */
+
+/* [] END OF FILE */
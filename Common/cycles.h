@@ -0,0 +1,43 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared cycle counter
+ * Cortex-M3 DWT CYCCNT, counts CPU cycles for timing code sections
+ * 
+ * ========================================
+*/
+#ifndef CYCLES_H
+#define CYCLES_H
+
+#include <project.h>
+#include "core_cm3_psoc5.h"
+
+/* Make sure the counter runs, the count is left as it is so start
+ * stamps taken elsewhere stay valid */
+#define Cycles_Enable() do { CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; \
+                             DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; } while (0)
+/* Enable and clear the counter, once at startup. DWT is only written
+ * once TRCENA is set. */
+#define Cycles_Start()  do { Cycles_Enable(); DWT->CYCCNT = 0u; } while (0)
+/* Current count, wraps every 2^32 cycles */
+#define Cycles_Now()    (DWT->CYCCNT)
+
+/* Last and largest cycle count of a measured section */
+typedef struct
+{
+    uint32 last;
+    uint32 max;
+} CycleStat;
+
+/* Record the cycles since start */
+#define Cycles_Record(stat, start)  do { (stat).last = Cycles_Now() - (start); \
+                                         if ((stat).last > (stat).max) (stat).max = (stat).last; } while (0)
+
+#endif /* CYCLES_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,118 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared event queue
+ * Interrupts post events with a payload, the main loop takes them out
+ * in order, without locks
+ *
+ * A poster claims the next event number with LDREX/STREX, so interrupts
+ * of any priority can post at the same time, even one nested in
+ * another. The claimed slot is written and then marked with its number,
+ * the main loop only takes a slot once the number is there. A slot is
+ * never reused before the main loop has taken it: a full queue drops
+ * the new event and counts it instead.
+ *
+ * ========================================
+*/
+#include "evq.h"
+#include "string.h"
+
+#if defined(__ARM_ARCH_7M__)
+    #include "core_cm3_psoc5.h"
+    #define EVQ_BARRIER()   __DMB()
+    #define EVQ_CLREX()     __CLREX()
+/* Load a word and watch it for a store from anywhere else */
+static inline uint32 EvQ_Load(volatile uint32 *p)
+{
+    return __LDREXW((volatile uint32_t *)p);
+}
+/* Store v if nothing touched the word since EvQ_Load, return 1 if it did */
+static inline int EvQ_Store(volatile uint32 *p, uint32 seen, uint32 v)
+{
+    (void) seen;
+    return __STREXW(v, (volatile uint32_t *)p);
+}
+#else
+    /* Host builds: the same claim with a compare and swap */
+    #define EVQ_BARRIER()   __atomic_thread_fence(__ATOMIC_SEQ_CST)
+    #define EVQ_CLREX()     do { } while (0)
+static inline uint32 EvQ_Load(volatile uint32 *p)
+{
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+static inline int EvQ_Store(volatile uint32 *p, uint32 seen, uint32 v)
+{
+    return !__atomic_compare_exchange_n(p, &seen, v, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#endif
+
+/* Subprocesses */
+/* Add one to a counter shared between interrupt levels */
+static void EvQ_Count(volatile uint32 *counter)
+{
+    uint32 claim;
+
+    do
+    {
+        claim = EvQ_Load(counter);
+    } while (EvQ_Store(counter, claim, claim + 1u));
+}
+
+void EvQ_Init(EventQueue *q)
+{
+    memset((void *)q, 0, sizeof(*q));
+}
+/* Queue an event, from an interrupt or from the main loop.
+ * Return 1 if the queue was full and the event was dropped. */
+int EvQ_Post(EventQueue *q, uint16 type, uint16 arg, uint32 data)
+{
+    uint32 claim, depth;
+    Event *ev;
+
+    do
+    {
+        claim = EvQ_Load(&q->head);
+        if (claim - q->tail >= EVQ_SIZE)
+        {
+            EVQ_CLREX();
+            EvQ_Count(&q->overflows);
+            return 1;
+        }
+    } while (EvQ_Store(&q->head, claim, claim + 1u));
+
+    ev = &q->slot[claim & (EVQ_SIZE - 1u)];
+    ev->type = type;
+    ev->arg = arg;
+    ev->data = data;
+    /* The payload is in memory before the slot is marked */
+    EVQ_BARRIER();
+    ev->seq = claim + 1u;
+    EvQ_Count(&q->posted);
+    depth = claim + 1u - q->tail;
+    if (depth > q->maxDepth) q->maxDepth = depth;
+    return 0;
+}
+/* Take the oldest event, main loop only. Return 1 if there was one. */
+int EvQ_Get(EventQueue *q, Event *ev)
+{
+    uint32 t = q->tail;
+    Event *s = &q->slot[t & (EVQ_SIZE - 1u)];
+
+    /* Empty, or the poster of the oldest one has not finished it */
+    if (s->seq != t + 1u) return 0;
+    EVQ_BARRIER();
+    ev->type = s->type;
+    ev->arg = s->arg;
+    ev->data = s->data;
+    /* Hand the slot back only after it is copied */
+    EVQ_BARRIER();
+    q->tail = t + 1u;
+    return 1;
+}
+
+/* [] END OF FILE */
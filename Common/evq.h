@@ -0,0 +1,51 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared event queue
+ * Interrupts post events with a payload, the main loop takes them out
+ * in order, without locks
+ *
+ * ========================================
+*/
+#ifndef EVQ_H
+#define EVQ_H
+
+#include <project.h>
+
+/* Events in a queue, a power of two */
+#define EVQ_SIZE        32u
+
+typedef struct
+{
+    volatile uint32 seq;    /* number of the event + 1 once it is written */
+    uint16 type;
+    uint16 arg;
+    uint32 data;
+} Event;
+
+typedef struct
+{
+    Event slot[EVQ_SIZE];
+    volatile uint32 head;   /* next number to hand to a poster */
+    volatile uint32 tail;   /* next number the main loop takes */
+    /* Statistics */
+    volatile uint32 posted;
+    volatile uint32 overflows;  /* events dropped on a full queue */
+    uint32 maxDepth;
+} EventQueue;
+
+void EvQ_Init(EventQueue *q);
+int EvQ_Post(EventQueue *q, uint16 type, uint16 arg, uint32 data);
+int EvQ_Get(EventQueue *q, Event *ev);
+
+/* Events waiting */
+#define EvQ_Depth(q)    ((q)->head - (q)->tail)
+
+#endif /* EVQ_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,165 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared idle hook
+ * Stops the CPU until the next cooperative task is due instead of
+ * spinning through empty passes
+ *
+ * The CPU waits for an interrupt (WFI) with every clock running, so the
+ * ADC, the UARTs, the PWMs and their interrupts go on and any of them
+ * wakes it. SysTick is the wakeup timer: the CPU only stops when the next
+ * deadline is past the next tick, the last part of a millisecond is
+ * spun. A task never wakes later than it would have without the hook.
+ *
+ * Deep sleep (CyPmSleep with a central timewheel wakeup) stops the clocks
+ * and the UDB peripherals with them, so it is only for firmware that
+ * has nothing running between its tasks. SysTick stops too, SysTime is
+ * moved on by the timewheel interval after the sleep. The timewheel runs
+ * on the 1 kHz ILO, its intervals are only as good as that clock.
+ * PSoC5_Ex1 runs it on the 'D' command and prints the clock restore time
+ * of both deep modes.
+ *
+ * ========================================
+*/
+#include "idle.h"
+#include "coop.h"
+#include "systime.h"
+#include "pmclk.h"
+#include "stdio.h"
+#include "string.h"
+
+IdleStat Idle_Stat;
+
+/* Deep sleep allowed, and its extra wakeup sources */
+static uint8 deepOk;
+static uint16 deepWakeups;
+/* Start of the measurement window, us */
+static uint32 windowStart;
+/* Time slept since startup, wraps, never reset */
+static uint32 sleptTotal;
+
+/* Subprocesses */
+/* Sleep for the longest timewheel interval in us, return the ms slept */
+static uint32 Idle_Deep(int32 us)
+{
+    uint32 ms = 2u, start;
+    uint8 interval = PM_SLEEP_TIME_CTW_2MS;
+
+    while ((int32)(ms * 2000u) <= us && interval < PM_SLEEP_TIME_CTW_4096MS)
+    {
+        ms *= 2u;
+        interval++;
+    }
+    if (deepOk == IDLE_DEEP_CYPM)
+    {
+        CyPmSaveClocks();
+        CyPmSleep(interval, PM_SLEEP_SRC_CTW | deepWakeups);
+        start = Cycles_Now();
+        CyPmRestoreClocks();
+    }
+    else
+    {
+        PmClk_Save();
+        CyPmSleep(interval, PM_SLEEP_SRC_CTW | deepWakeups);
+        start = Cycles_Now();
+        PmClk_Restore();
+    }
+    Cycles_Record(Idle_Stat.restore, start);
+    /* Woken by another source: the time slept is not known, SysTime
+     * stays behind and the tasks run late rather than early */
+    if (CyPmReadStatus(CY_PM_CTW_INT) & CY_PM_CTW_INT) return ms;
+    return 0u;
+}
+
+/* deep (IDLE_DEEP_FAST or IDLE_DEEP_CYPM) lets the idle hook stop the
+ * clocks for IDLE_DEEP_MIN_MS or more, 0 keeps them running. wakeups are
+ * the PM_SLEEP_SRC sources that end it early besides the timewheel.
+ * Starts a measurement window. */
+void Idle_Start(uint8 deep, uint16 wakeups)
+{
+    deepOk = deep;
+    deepWakeups = wakeups;
+    memset(&Idle_Stat, 0, sizeof(Idle_Stat));
+    /* The clock restore is timed in CPU cycles */
+    if (deep) Cycles_Enable();
+    windowStart = SysTime_Us();
+}
+/* Sleep until the next task is due or an interrupt came. Call it from
+ * main when Coop_Run ran nothing. */
+void Idle_Run(void)
+{
+    uint32 start, end, late, slept = 0u;
+    int32 idle;
+    uint8 intState = CyEnterCriticalSection();
+
+    /* Interrupts stay off from the check to the sleep, a signal on the
+     * way still ends the WFI */
+    start = SysTime_Us();
+    idle = Coop_IdleUs();
+    if (idle == 0 || SysTime_Diff(start + (uint32)idle, SysTime_NextTickUs()) < 0)
+    {
+        CyExitCriticalSection(intState);
+        return;
+    }
+    if (deepOk && idle >= (int32)(IDLE_DEEP_MIN_MS * 1000u))
+    {
+        slept = Idle_Deep(idle);
+        SysTime_Advance(slept);
+        Idle_Stat.deepSleeps++;
+    }
+    else
+    {
+        CY_PM_WFI;
+    }
+    CyExitCriticalSection(intState);
+
+    /* The interrupt that woke the CPU has run */
+    end = SysTime_Us();
+    Idle_Stat.sleeps++;
+    Idle_Stat.sleepUs += end - start;
+    sleptTotal += end - start;
+    if (idle != COOP_FOREVER && SysTime_Diff(end, start + (uint32)idle) >= 0)
+    {
+        late = end - start - (uint32)idle;
+        if (late > Idle_Stat.lateMax) Idle_Stat.lateMax = late;
+        Idle_Stat.lateSum += late;
+        Idle_Stat.wakes++;
+    }
+}
+/* Share of the time since the window started that the CPU ran */
+uint16 Idle_AwakePermille(void)
+{
+    uint32 total = (SysTime_Us() - windowStart) / 1000u;
+
+    if (total == 0u || Idle_Stat.sleepUs / total > 1000u) return 0u;
+    return (uint16)(1000u - Idle_Stat.sleepUs / total);
+}
+/* Time slept since startup, us. Take differences for a window of your
+ * own, the reports do not reset it. */
+uint32 Idle_SleptUs(void)
+{
+    return sleptTotal;
+}
+/* Print the awake share, the sleeps and how late they ended, then start
+ * a new window */
+void Idle_Report(void (*out)(const char *s))
+{
+    char buf[72];
+    uint16 awake = Idle_AwakePermille();
+
+    sprintf(buf, "awake %u.%u %%, %lu sleeps, %lu deep\r\n", awake / 10u, awake % 10u,
+            Idle_Stat.sleeps, Idle_Stat.deepSleeps);
+    out(buf);
+    sprintf(buf, "wake late %lu/%lu us, clock restore %lu cycles\r\n",
+            Idle_Stat.wakes ? Idle_Stat.lateSum / Idle_Stat.wakes : 0u, Idle_Stat.lateMax,
+            Idle_Stat.restore.max);
+    out(buf);
+    Idle_Start(deepOk, deepWakeups);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,49 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared idle hook
+ * Stops the CPU until the next cooperative task is due instead of
+ * spinning through empty passes
+ *
+ * ========================================
+*/
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <project.h>
+#include "cycles.h"
+
+/* Shortest deep sleep, below it the clock restore costs more than it saves */
+#define IDLE_DEEP_MIN_MS    4u
+/* Idle_Start deep modes: the clocks are restored after a deep sleep
+ * with PmClk, or with the generated CyPmRestoreClocks to compare the two */
+#define IDLE_DEEP_FAST      1u
+#define IDLE_DEEP_CYPM      2u
+
+typedef struct
+{
+    uint32 sleeps;
+    uint32 deepSleeps;
+    uint32 sleepUs;             /* time the CPU was stopped */
+    uint32 wakes;               /* sleeps that ended on or past a deadline */
+    uint32 lateMax;             /* longest delay from a deadline to waking, us */
+    uint32 lateSum;
+    CycleStat restore;          /* wakeup to the first task instruction, cycles */
+} IdleStat;
+
+extern IdleStat Idle_Stat;
+
+void Idle_Start(uint8 deep, uint16 wakeups);
+void Idle_Run(void);
+uint16 Idle_AwakePermille(void);
+uint32 Idle_SleptUs(void);
+void Idle_Report(void (*out)(const char *s));
+
+#endif /* IDLE_H */
+
+/* [] END OF FILE */
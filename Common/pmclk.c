@@ -0,0 +1,157 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared clock save and restore around sleep
+ * Drop-in for CyPmSaveClocks/CyPmRestoreClocks with a shorter wakeup
+ * for the usual IMO and PLL clock tree
+ *
+ * The generated functions handle every clock tree the designer allows
+ * and wait out each settling time on its own: 75 us for the clock delay
+ * line, then 80 us and up to 171 us more for the PLL. This tree is the
+ * IMO, maybe through the PLL, into the master clock. The PLL only needs
+ * the IMO, so on wakeup it is started first and the delay line settles
+ * during its lock wait. Dividers, the IMO frequency and the flash wait
+ * states are only written when they differ from what the sleep left.
+ *
+ * A crystal, the IMO doubler, the USB trim or a DSI clock anywhere in
+ * the tree sends both calls to the generated functions.
+ *
+ * The registers go through reg.h, Host/pmclk_sim.c runs this file
+ * against a model of the clock tree.
+ *
+ * ========================================
+*/
+#include "pmclk.h"
+#include "regclk.h"
+
+/* PLL lock: wait before the first poll and the longest poll after, us */
+#define PMCLK_PLL_SETTLE_US 80u
+#define PMCLK_PLL_LOCK_US   171u
+/* Clock delay line: bandgap and bias settling, us */
+#define PMCLK_DELAY_US      (CY_PM_CLK_DELAY_BANDGAP_SETTLE_US + CY_PM_CLK_DELAY_BIAS_SETTLE_US)
+
+/* IMO frequency field of FASTCLK_IMO_CR to CyIMO_SetFreq value and MHz */
+static const uint8 CYCODE imoReg2Freq[7] =
+{
+    CY_IMO_FREQ_12MHZ, CY_IMO_FREQ_6MHZ, CY_IMO_FREQ_24MHZ, CY_IMO_FREQ_3MHZ,
+    CY_IMO_FREQ_48MHZ, CY_IMO_FREQ_62MHZ, CY_IMO_FREQ_74MHZ
+};
+static const uint8 CYCODE imoReg2Mhz[7] = { 12u, 6u, 24u, 3u, 48u, 62u, 74u };
+
+/* Clock state before the sleep */
+static struct
+{
+    uint8 generated;        /* tree not handled here, the generated functions have it */
+    uint8 enClkA;
+    uint8 enClkD;
+    uint8 flashWait;
+    uint8 imoFreq;          /* FASTCLK_IMO_CR frequency field */
+    uint8 masterSrc;
+    uint8 masterDiv;
+    uint16 busDiv;
+    uint8 pll;
+    uint8 delay;
+} saved;
+
+/* Subprocesses */
+static uint16 PmClk_BusDiv(void)
+{
+    return (uint16)((uint16)Reg8_Get(REG_CLKDIST_BCFG1) << 8u) | Reg8_Get(REG_CLKDIST_BCFG0);
+}
+
+/* Put the clocks in the state CyPmSleep expects, the master clock on the
+ * IMO at full speed with the PLL off */
+void PmClk_Save(void)
+{
+    uint8 imo = Reg8_Get(REG_FASTCLK_IMO_CR);
+    uint8 dist = Reg8_Get(REG_CLKDIST_CR);
+
+    saved.masterSrc = Field8_Get(FLD_CLKDIST_MSTR_SRC);
+    saved.generated = Field8_Of(FLD_IMO_XCLKEN, imo) || Field8_Of(FLD_IMO_F2XON, imo) || Field8_Of(FLD_IMO_USB, imo)
+        || Field8_Get(FLD_XMHZ_ENABLE)
+        || Field8_Of(FLD_CLKDIST_IMO_OUT, dist) != REGCLK_IMO_OUT_IMO
+        || (saved.masterSrc != CY_MASTER_SOURCE_IMO && saved.masterSrc != CY_MASTER_SOURCE_PLL)
+        || (saved.masterSrc == CY_MASTER_SOURCE_PLL
+            && Field8_Of(FLD_CLKDIST_PLL_SRC, dist) != REGCLK_PLL_SRC_IMO);
+    if (saved.generated)
+    {
+        CyPmSaveClocks();
+        return;
+    }
+
+    /* The digital and analog clocks stop before their source changes */
+    saved.enClkA = Field8_Get(FLD_PM_EN_CLK_A);
+    saved.enClkD = Reg8_Get(REG_PM_ACT_CFG2);
+    Field8_Set(FLD_PM_EN_CLK_A, 0u);
+    Reg8_Set(REG_PM_ACT_CFG2, 0u);
+    /* Enough wait states for any clock on the way */
+    saved.flashWait = Field8_Get(FLD_CACHE_WAIT);
+    CyFlash_SetWaitCycles(CY_PM_MAX_FLASH_WAIT_CYCLES);
+
+    saved.imoFreq = Field8_Of(FLD_IMO_FREQ, imo);
+    saved.pll = Field8_Get(FLD_PLL_ENABLE);
+    saved.delay = Field8_Get(FLD_CLKDIST_DLY_EN);
+    saved.masterDiv = Reg8_Get(REG_CLKDIST_MSTR0);
+    saved.busDiv = PmClk_BusDiv();
+
+    /* Off the PLL before it stops, the IMO is its source */
+    if (saved.masterSrc == CY_MASTER_SOURCE_PLL) CyMasterClk_SetSource(CY_MASTER_SOURCE_IMO);
+    if (saved.pll) CyPLL_OUT_Stop();
+    /* The sleep entry and the wakeup run from the IMO undivided */
+    if (imoReg2Freq[saved.imoFreq] != CY_PM_IMO_FREQ_LPM) CyIMO_SetFreq(CY_PM_IMO_FREQ_LPM);
+    if (saved.masterDiv != CY_PM_DIV_BY_ONE) CyMasterClk_SetDivider(CY_PM_DIV_BY_ONE);
+    if (saved.busDiv != CY_PM_BUS_CLK_DIV_BY_ONE) CyBusClk_SetDivider(CY_PM_BUS_CLK_DIV_BY_ONE);
+}
+/* Bring back the clocks PmClk_Save found */
+void PmClk_Restore(void)
+{
+    uint32 mhz;
+    uint16 i;
+
+    if (saved.generated)
+    {
+        CyPmRestoreClocks();
+        return;
+    }
+
+    /* The PLL input first, then the PLL, the rest overlaps its lock */
+    if (Field8_Get(FLD_IMO_FREQ) != saved.imoFreq) CyIMO_SetFreq(imoReg2Freq[saved.imoFreq]);
+    mhz = imoReg2Mhz[saved.imoFreq];
+    if (saved.pll)
+    {
+        (void) CyPLL_OUT_Start(CY_PM_PLL_OUT_NO_WAIT);
+        /* Covers the delay line settling as well */
+        CyDelayCycles(PMCLK_PLL_SETTLE_US * mhz);
+    }
+    else if (saved.delay)
+    {
+        CyDelayCycles(PMCLK_DELAY_US * mhz);
+    }
+    if (saved.delay) Field8_Set(FLD_CLKDIST_DLY_EN, 1u);
+
+    if (saved.pll)
+    {
+        /* Read to clear the lock status, then two locked reads in a row */
+        (void) Reg8_Get(REG_FASTCLK_PLL_SR);
+        for (i = PMCLK_PLL_LOCK_US; i > 0u; i--)
+        {
+            if (Field8_Get(FLD_PLL_LOCKED) && Field8_Get(FLD_PLL_LOCKED)) break;
+            CyDelayCycles(mhz);
+        }
+    }
+
+    /* Dividers before the source, the master clock never runs too fast */
+    if (Reg8_Get(REG_CLKDIST_MSTR0) != saved.masterDiv) CyMasterClk_SetDivider(saved.masterDiv);
+    if (saved.masterSrc == CY_MASTER_SOURCE_PLL) CyMasterClk_SetSource(CY_MASTER_SOURCE_PLL);
+    if (PmClk_BusDiv() != saved.busDiv) CyBusClk_SetDivider(saved.busDiv);
+    Field8_Set(FLD_CACHE_WAIT, saved.flashWait);
+    Field8_Set(FLD_PM_EN_CLK_A, saved.enClkA);
+    Reg8_Set(REG_PM_ACT_CFG2, saved.enClkD);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,25 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared clock save and restore around sleep
+ * Drop-in for CyPmSaveClocks/CyPmRestoreClocks with a shorter wakeup
+ * for the usual IMO and PLL clock tree
+ *
+ * ========================================
+*/
+#ifndef PMCLK_H
+#define PMCLK_H
+
+#include <project.h>
+
+void PmClk_Save(void);
+void PmClk_Restore(void);
+
+#endif /* PMCLK_H */
+
+/* [] END OF FILE */
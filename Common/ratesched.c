@@ -0,0 +1,82 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared rate scheduler
+ * Runs each job at its own period and phase from the main loop
+ * 
+ * ========================================
+*/
+#include "ratesched.h"
+#include "systime.h"
+#include "stdio.h"
+
+/* Subprocesses */
+/* Clear the statistics and set the first release of each job to its phase */
+void RateSched_Init(RateJob *jobs, uint8 count)
+{
+    uint32 now = SysTime_Us();
+    uint8 i;
+
+    for (i = 0u; i < count; i++)
+    {
+        jobs[i].next = now + jobs[i].phaseUs;
+        jobs[i].runs = 0u;
+        jobs[i].misses = 0u;
+        jobs[i].jitterMax = 0u;
+        jobs[i].jitterSum = 0u;
+    }
+}
+/* Run every job whose release time has passed, in table order.
+ * Call it on every pass of the main loop, or sleep until the returned
+ * time stamp: the earliest next release. */
+uint32 RateSched_Run(RateJob *jobs, uint8 count)
+{
+    RateJob *job;
+    uint32 now, late, skipped, first = 0u;
+    uint8 i;
+
+    for (i = 0u; i < count; i++)
+    {
+        job = &jobs[i];
+        now = SysTime_Us();
+        if (SysTime_Diff(now, job->next) < 0)
+        {
+            if (i == 0u || SysTime_Diff(job->next, first) < 0) first = job->next;
+            continue;
+        }
+
+        /* Start delay after the release */
+        late = now - job->next;
+        if (late > job->jitterMax) job->jitterMax = late;
+        job->jitterSum += late;
+        /* Releases that passed while we were late are dropped, not queued */
+        skipped = late / job->periodUs;
+        job->misses += skipped;
+        job->next += (skipped + 1u) * job->periodUs;
+        job->runs++;
+        job->run();
+        if (i == 0u || SysTime_Diff(job->next, first) < 0) first = job->next;
+    }
+    return first;
+}
+/* Print runs, misses, mean and max jitter of every job */
+void RateSched_Report(const RateJob *jobs, uint8 count, void (*out)(const char *s))
+{
+    char buf[64];
+    uint8 i;
+
+    for (i = 0u; i < count; i++)
+    {
+        sprintf(buf, "%-8s %8lu runs %6lu miss %6lu/%6lu us jitter\r\n", jobs[i].name,
+                jobs[i].runs, jobs[i].misses,
+                jobs[i].runs ? jobs[i].jitterSum / jobs[i].runs : 0u, jobs[i].jitterMax);
+        out(buf);
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,41 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared rate scheduler
+ * Runs each job at its own period and phase from the main loop
+ * 
+ * ========================================
+*/
+#ifndef RATESCHED_H
+#define RATESCHED_H
+
+#include <project.h>
+
+/* One periodic job. name, run, period and phase are set by the user,
+ * the rest is kept by the scheduler. */
+typedef struct
+{
+    const char *name;
+    void (*run)(void);
+    uint32 periodUs;
+    uint32 phaseUs;
+    /* Scheduler state and statistics */
+    uint32 next;        /* next release, us */
+    uint32 runs;
+    uint32 misses;      /* releases skipped because the job was a period late */
+    uint32 jitterMax;   /* largest start delay after the release, us */
+    uint32 jitterSum;
+} RateJob;
+
+void RateSched_Init(RateJob *jobs, uint8 count);
+uint32 RateSched_Run(RateJob *jobs, uint8 count);
+void RateSched_Report(const RateJob *jobs, uint8 count, void (*out)(const char *s));
+
+#endif /* RATESCHED_H */
+
+/* [] END OF FILE */
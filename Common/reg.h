@@ -0,0 +1,105 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared typed register access
+ * Registers and their fields as types of their own instead of bare
+ * addresses, with accesses that compile to the plain loads and stores
+ *
+ * CY_GET_REG8(addr) takes any number, and a field is only a mask that
+ * can be used with any register. Here a register is a Reg8 and a field a
+ * Field8 that knows its register, mask and shift, so giving a value
+ * where a register belongs, or one register's field to another, does not
+ * compile. Everything is static inline over compile time constants: a
+ * Field8_Set is one load, an and, an or and one store, and fields of the
+ * same register given to one Reg8_Modify still make one load and one
+ * store.
+ *
+ * Host builds define REG_HOST. Every access then goes to the register
+ * file of Host/regsim.c, which counts loads and stores and lets a model
+ * answer reads and see writes, so drivers run and are measured off the
+ * target.
+ *
+ * ========================================
+*/
+#ifndef REG_H
+#define REG_H
+
+#include <project.h>
+
+/* A register, by address */
+typedef struct
+{
+    uint32 addr;
+} Reg8;
+
+/* A field: its register, mask in place and shift of the lowest bit */
+typedef struct
+{
+    Reg8 reg;
+    uint8 mask;
+    uint8 shift;
+} Field8;
+
+#define REG8(addr)                  ((Reg8) { (uint32)(addr) })
+#define FIELD8(addr, mask, shift)   ((Field8) { { (uint32)(addr) }, (uint8)(mask), (uint8)(shift) })
+
+#if defined(REG_HOST)
+
+/* Host/regsim.c */
+uint8 RegSim_Read8(uint32 addr);
+void RegSim_Write8(uint32 addr, uint8 value);
+
+static CY_INLINE uint8 Reg8_Get(Reg8 r)
+{
+    return RegSim_Read8(r.addr);
+}
+static CY_INLINE void Reg8_Set(Reg8 r, uint8 value)
+{
+    RegSim_Write8(r.addr, value);
+}
+
+#else
+
+static CY_INLINE uint8 Reg8_Get(Reg8 r)
+{
+    return *(reg8 *)r.addr;
+}
+static CY_INLINE void Reg8_Set(Reg8 r, uint8 value)
+{
+    *(reg8 *)r.addr = value;
+}
+
+#endif /* REG_HOST */
+
+/* Replace the bits of mask with bits, one load and one store */
+static CY_INLINE void Reg8_Modify(Reg8 r, uint8 mask, uint8 bits)
+{
+    Reg8_Set(r, (uint8)((Reg8_Get(r) & (uint8)~mask) | (bits & mask)));
+}
+/* Field value in place, to combine fields of one register */
+static CY_INLINE uint8 Field8_Val(Field8 f, uint8 value)
+{
+    return (uint8)((uint8)(value << f.shift) & f.mask);
+}
+/* Field value out of a register value read before */
+static CY_INLINE uint8 Field8_Of(Field8 f, uint8 regValue)
+{
+    return (uint8)((regValue & f.mask) >> f.shift);
+}
+static CY_INLINE uint8 Field8_Get(Field8 f)
+{
+    return Field8_Of(f, Reg8_Get(f.reg));
+}
+static CY_INLINE void Field8_Set(Field8 f, uint8 value)
+{
+    Reg8_Modify(f.reg, f.mask, Field8_Val(f, value));
+}
+
+#endif /* REG_H */
+
+/* [] END OF FILE */
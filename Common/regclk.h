@@ -0,0 +1,86 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared clock tree registers
+ * Typed registers and fields of the clock distribution, the IMO, the
+ * PLL and the power manager, for reg.h
+ *
+ * The addresses are those of cydevice_trm.h written out, so host builds
+ * need no generated source, and target builds check them against it.
+ * The fields are from the PSoC 5LP registers TRM and match the masks
+ * cyPm.h uses.
+ *
+ * ========================================
+*/
+#ifndef REGCLK_H
+#define REGCLK_H
+
+#include "reg.h"
+
+#define REGCLK_CLKDIST_CR       0x40004000u
+#define REGCLK_CLKDIST_MSTR0    0x40004004u
+#define REGCLK_CLKDIST_MSTR1    0x40004005u
+#define REGCLK_CLKDIST_BCFG0    0x40004006u
+#define REGCLK_CLKDIST_BCFG1    0x40004007u
+#define REGCLK_CLKDIST_DLY1     0x4000400Bu
+#define REGCLK_FASTCLK_IMO_CR   0x40004200u
+#define REGCLK_FASTCLK_XMHZ_CSR 0x40004210u
+#define REGCLK_FASTCLK_PLL_CFG0 0x40004220u
+#define REGCLK_FASTCLK_PLL_SR   0x40004225u
+#define REGCLK_PM_ACT_CFG1      0x400043A1u
+#define REGCLK_PM_ACT_CFG2      0x400043A2u
+#define REGCLK_CACHE_CC_CTL     0x40004800u
+
+/* Registers */
+#define REG_CLKDIST_CR          REG8(REGCLK_CLKDIST_CR)
+#define REG_CLKDIST_MSTR0       REG8(REGCLK_CLKDIST_MSTR0)     // master clock divider - 1
+#define REG_CLKDIST_MSTR1       REG8(REGCLK_CLKDIST_MSTR1)
+#define REG_CLKDIST_BCFG0       REG8(REGCLK_CLKDIST_BCFG0)     // bus clock divider - 1, low byte
+#define REG_CLKDIST_BCFG1       REG8(REGCLK_CLKDIST_BCFG1)     // and high byte
+#define REG_CLKDIST_DLY1        REG8(REGCLK_CLKDIST_DLY1)
+#define REG_FASTCLK_IMO_CR      REG8(REGCLK_FASTCLK_IMO_CR)
+#define REG_FASTCLK_XMHZ_CSR    REG8(REGCLK_FASTCLK_XMHZ_CSR)
+#define REG_FASTCLK_PLL_CFG0    REG8(REGCLK_FASTCLK_PLL_CFG0)
+#define REG_FASTCLK_PLL_SR      REG8(REGCLK_FASTCLK_PLL_SR)
+#define REG_PM_ACT_CFG1         REG8(REGCLK_PM_ACT_CFG1)
+#define REG_PM_ACT_CFG2         REG8(REGCLK_PM_ACT_CFG2)       // one enable per digital clock
+#define REG_CACHE_CC_CTL        REG8(REGCLK_CACHE_CC_CTL)
+
+/* Fields */
+#define FLD_CLKDIST_PLL_SRC     FIELD8(REGCLK_CLKDIST_CR, 0x03u, 0u)
+#define FLD_CLKDIST_IMO_OUT     FIELD8(REGCLK_CLKDIST_CR, 0x30u, 4u)
+#define FLD_CLKDIST_MSTR_SRC    FIELD8(REGCLK_CLKDIST_MSTR1, 0x03u, 0u)     // CY_MASTER_SOURCE_x
+#define FLD_CLKDIST_DLY_EN      FIELD8(REGCLK_CLKDIST_DLY1, 0x04u, 2u)      // delay line on
+#define FLD_IMO_FREQ            FIELD8(REGCLK_FASTCLK_IMO_CR, 0x07u, 0u)
+#define FLD_IMO_F2XON           FIELD8(REGCLK_FASTCLK_IMO_CR, 0x10u, 4u)    // doubler
+#define FLD_IMO_XCLKEN          FIELD8(REGCLK_FASTCLK_IMO_CR, 0x20u, 5u)    // external clock
+#define FLD_IMO_USB             FIELD8(REGCLK_FASTCLK_IMO_CR, 0x40u, 6u)    // USB trim
+#define FLD_XMHZ_ENABLE         FIELD8(REGCLK_FASTCLK_XMHZ_CSR, 0x01u, 0u)
+#define FLD_PLL_ENABLE          FIELD8(REGCLK_FASTCLK_PLL_CFG0, 0x01u, 0u)
+#define FLD_PLL_LOCKED          FIELD8(REGCLK_FASTCLK_PLL_SR, 0x01u, 0u)    // cleared by the read
+#define FLD_PM_EN_CLK_A         FIELD8(REGCLK_PM_ACT_CFG1, 0x0Fu, 0u)       // one enable per analog clock
+#define FLD_CACHE_WAIT          FIELD8(REGCLK_CACHE_CC_CTL, 0xC0u, 6u)      // flash wait states
+
+/* Field values */
+#define REGCLK_PLL_SRC_IMO      0u
+#define REGCLK_IMO_OUT_IMO      0u
+
+#if !defined(REG_HOST)
+/* Stops the build if an address is not the one cydevice_trm.h has */
+typedef char RegClk_Ok[(REGCLK_CLKDIST_CR == CYREG_CLKDIST_CR && REGCLK_CLKDIST_MSTR0 == CYREG_CLKDIST_MSTR0 &&
+                        REGCLK_CLKDIST_MSTR1 == CYREG_CLKDIST_MSTR1 && REGCLK_CLKDIST_BCFG0 == CYREG_CLKDIST_BCFG0 &&
+                        REGCLK_CLKDIST_BCFG1 == CYREG_CLKDIST_BCFG1 && REGCLK_CLKDIST_DLY1 == CYREG_CLKDIST_DLY1 &&
+                        REGCLK_FASTCLK_IMO_CR == CYREG_FASTCLK_IMO_CR && REGCLK_FASTCLK_XMHZ_CSR == CYREG_FASTCLK_XMHZ_CSR &&
+                        REGCLK_FASTCLK_PLL_CFG0 == CYREG_FASTCLK_PLL_CFG0 && REGCLK_FASTCLK_PLL_SR == CYREG_FASTCLK_PLL_SR &&
+                        REGCLK_PM_ACT_CFG1 == CYREG_PM_ACT_CFG1 && REGCLK_PM_ACT_CFG2 == CYREG_PM_ACT_CFG2 &&
+                        REGCLK_CACHE_CC_CTL == CYREG_CACHE_CC_CTL) ? 1 : -1];
+#endif /* REG_HOST */
+
+#endif /* REGCLK_H */
+
+/* [] END OF FILE */
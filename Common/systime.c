@@ -0,0 +1,80 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared system time
+ * 1 ms SysTick count with microsecond interpolation
+ * 
+ * ========================================
+*/
+#include "systime.h"
+
+volatile uint32 SysTime_ms = 0;
+
+/* SysTick reload value, one tick is reload + 1 cycles */
+static uint32 reload;
+
+static void SysTime_Tick(void)
+{
+    SysTime_ms++;
+}
+
+/* Subprocesses */
+/* Start SysTick at 1 ms (CySysTickStart default) and hook the tick count
+ * into the first free callback slot. */
+void SysTime_Start(void)
+{
+    uint32 i;
+
+    CySysTickStart();
+    reload = CySysTickGetReload();
+    for (i = 0u; i < CY_SYS_SYST_NUM_OF_CALLBACKS; i++)
+    {
+        if (CySysTickGetCallback(i) == SysTime_Tick) return;
+    }
+    for (i = 0u; i < CY_SYS_SYST_NUM_OF_CALLBACKS; i++)
+    {
+        if (CySysTickGetCallback(i) == NULL)
+        {
+            (void) CySysTickSetCallback(i, SysTime_Tick);
+            return;
+        }
+    }
+}
+/* Count ms that passed with SysTick stopped, after a sleep with the
+ * clocks off */
+void SysTime_Advance(uint32 ms)
+{
+    uint8 intState = CyEnterCriticalSection();
+
+    SysTime_ms += ms;
+    CyExitCriticalSection(intState);
+}
+/* Follow a new bus clock, SysTick counts it. Call it with interrupts
+ * disabled, the millisecond in progress starts over. */
+void SysTime_SetClock(uint32 hz)
+{
+    reload = hz / 1000u - 1u;
+    CySysTickSetReload(reload);
+    CySysTickClear();
+}
+/* Microseconds since SysTime_Start, wraps after 71 minutes.
+ * The SysTick counter counts down from reload within each millisecond.
+ * With interrupts disabled across a tick the result can be 1 ms short. */
+uint32 SysTime_Us(void)
+{
+    uint32 ms, val;
+
+    do
+    {
+        ms = SysTime_ms;
+        val = CySysTickGetValue();
+    } while (ms != SysTime_ms);
+    return ms * 1000u + ((reload - val) * 1000u) / (reload + 1u);
+}
+
+/* [] END OF FILE */
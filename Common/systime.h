@@ -0,0 +1,36 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Shared system time
+ * 1 ms SysTick count with microsecond interpolation
+ * 
+ * ========================================
+*/
+#ifndef SYSTIME_H
+#define SYSTIME_H
+
+#include <project.h>
+
+/* Milliseconds since SysTime_Start, updated by the SysTick interrupt */
+extern volatile uint32 SysTime_ms;
+
+void SysTime_Start(void);
+uint32 SysTime_Us(void);
+void SysTime_Advance(uint32 ms);
+void SysTime_SetClock(uint32 hz);
+
+/* Milliseconds since SysTime_Start */
+#define SysTime_Now()           (SysTime_ms)
+/* SysTime_Us time stamp of the next tick */
+#define SysTime_NextTickUs()    ((SysTime_ms + 1u) * 1000u)
+/* Signed difference a - b of two wrapping time stamps */
+#define SysTime_Diff(a, b)      ((int32)((uint32)(a) - (uint32)(b)))
+
+#endif /* SYSTIME_H */
+
+/* [] END OF FILE */
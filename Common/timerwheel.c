@@ -0,0 +1,157 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared software timers
+ * Hierarchical timer wheel on the 1 ms SysTick tick
+ *
+ * Level 0 has a slot per tick for the next 64 ticks, each slot of
+ * level 1 covers 64 ticks and so on. Starting or stopping a timer links
+ * or unlinks it in one slot. Every 64 ticks one slot of the level above
+ * is spread over the level below, so a timer is moved at most three
+ * times in its life whatever the number of timers. The timers are the
+ * list nodes, nothing is allocated.
+ *
+ * Start and Stop may be called from interrupts, the callbacks run in
+ * TimerWheel_Run, from the main loop.
+ *
+ * ========================================
+*/
+#include "timerwheel.h"
+#include "string.h"
+
+#define TW_MASK         (TW_SLOTS - 1u)
+
+static Timer *wheel[TW_LEVELS][TW_SLOTS];
+/* Next tick to process */
+static uint32 base;
+
+/* Subprocesses */
+/* Put t in the slot for its expiry, relative to base */
+static void Wheel_Link(Timer *t)
+{
+    uint32 delta = t->expires - base;
+    Timer **slot;
+    uint8 level;
+
+    if ((int32)delta < 0)
+    {
+        /* Already due, the next tick takes it */
+        slot = &wheel[0][base & TW_MASK];
+    }
+    else
+    {
+        if (delta > TW_MAX_TICKS)
+        {
+            delta = TW_MAX_TICKS;
+            t->expires = base + delta;
+        }
+        for (level = 0u; delta >= TW_SLOTS; level++) delta >>= TW_BITS;
+        slot = &wheel[level][(t->expires >> (level * TW_BITS)) & TW_MASK];
+    }
+    t->next = *slot;
+    if (t->next) t->next->pprev = &t->next;
+    t->pprev = slot;
+    *slot = t;
+}
+
+static void Wheel_Unlink(Timer *t)
+{
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+    t->pprev = NULL;
+}
+/* Spread one slot of level over the levels below */
+static void Wheel_Cascade(uint8 level, uint8 index)
+{
+    Timer *t = wheel[level][index], *next;
+
+    wheel[level][index] = NULL;
+    for (; t; t = next)
+    {
+        next = t->next;
+        Wheel_Link(t);
+    }
+}
+
+/* Empty the wheel, now is the first tick TimerWheel_Run will be given */
+void TimerWheel_Init(uint32 now)
+{
+    memset(wheel, 0, sizeof(wheel));
+    base = now;
+}
+/* Expire ticks from now, then every period ticks if period is not 0.
+ * A running timer is moved to the new time. */
+void TimerWheel_Start(Timer *t, uint32 ticks, uint32 period)
+{
+    uint8 intState = CyEnterCriticalSection();
+
+    if (t->pprev) Wheel_Unlink(t);
+    t->expires = base + ticks;
+    t->period = period;
+    Wheel_Link(t);
+    CyExitCriticalSection(intState);
+}
+/* Stop t, nothing happens if it is not running */
+void TimerWheel_Stop(Timer *t)
+{
+    uint8 intState = CyEnterCriticalSection();
+
+    if (t->pprev) Wheel_Unlink(t);
+    CyExitCriticalSection(intState);
+}
+/* Process every tick up to and including now and run the callbacks of
+ * the timers that expired. Return how many did. */
+uint16 TimerWheel_Run(uint32 now)
+{
+    uint16 fired = 0u;
+    uint8 intState, level, index;
+    Timer *t;
+
+    while ((int32)(now - base) >= 0)
+    {
+        intState = CyEnterCriticalSection();
+        index = base & TW_MASK;
+        /* Level 0 wrapped: bring down the next slot of each level that did */
+        for (level = 1u; index == 0u && level < TW_LEVELS; level++)
+        {
+            index = (base >> (level * TW_BITS)) & TW_MASK;
+            Wheel_Cascade(level, index);
+        }
+        index = base & TW_MASK;
+        CyExitCriticalSection(intState);
+
+        for (;;)
+        {
+            intState = CyEnterCriticalSection();
+            t = wheel[0][index];
+            if (t == NULL)
+            {
+                /* Still inside: a timer an interrupt starts for this tick
+                 * from now on goes in the next slot, not round the wheel */
+                base++;
+                CyExitCriticalSection(intState);
+                break;
+            }
+            Wheel_Unlink(t);
+            if (t->period)
+            {
+                /* Periodic: next expiry from the last one, no drift,
+                 * unless that is already behind */
+                t->expires += t->period;
+                if ((int32)(t->expires - base) <= 0) t->expires = base + t->period;
+                Wheel_Link(t);
+            }
+            CyExitCriticalSection(intState);
+            t->expire(t);
+            fired++;
+        }
+    }
+    return fired;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,49 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared software timers
+ * Hierarchical timer wheel on the 1 ms SysTime tick
+ *
+ * ========================================
+*/
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <project.h>
+
+/* 4 levels of 64 slots reach 2^24 ticks (4.6 hours at 1 ms),
+ * longer timeouts are cut to that */
+#define TW_LEVELS       4
+#define TW_BITS         6
+#define TW_SLOTS        (1u << TW_BITS)
+#define TW_MAX_TICKS    ((1ul << (TW_LEVELS * TW_BITS)) - 1u)
+
+/* One timer, owned by the user and zeroed before first use (static
+ * storage is). Set expire before starting it, the other fields are kept
+ * by the wheel. */
+typedef struct Timer
+{
+    struct Timer *next;
+    struct Timer **pprev;       /* link that points here, NULL when stopped */
+    uint32 expires;             /* tick */
+    uint32 period;              /* ticks, 0 for a one-shot */
+    void (*expire)(struct Timer *t);
+    void *arg;                  /* free for the callback */
+} Timer;
+
+void TimerWheel_Init(uint32 now);
+void TimerWheel_Start(Timer *t, uint32 ticks, uint32 period);
+void TimerWheel_Stop(Timer *t);
+uint16 TimerWheel_Run(uint32 now);
+
+/* Nonzero while t is armed */
+#define TimerWheel_Armed(t)     ((t)->pprev != NULL)
+
+#endif /* TIMERWHEEL_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,106 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared microsecond delays
+ * Waits on absolute deadlines of the free-running DWT cycle counter
+ * instead of counting loop iterations
+ *
+ * CyDelayUs spins a loop counted out for the bus clock, any flash wait
+ * state the loop meets makes it longer, and every interrupt taken in the
+ * loop adds its own time to the delay. The cycle counter counts CPU
+ * cycles whatever the code runs from, and a wait for a time stamp ends
+ * at that time stamp even after an interrupt. A sequence of waits on t, t + a, t + a + b
+ * keeps its edges where they belong: an interrupt can make one edge
+ * late, it does not push the ones after it.
+ *
+ * ========================================
+*/
+#include "usdelay.h"
+#include "cycles.h"
+#include "stdio.h"
+#include "string.h"
+
+/* Subprocesses */
+/* Start the cycle counter, once at startup */
+void UsDelay_Start(void)
+{
+    Cycles_Start();
+}
+/* Cycle counter now */
+uint32 UsDelay_Now(void)
+{
+    return Cycles_Now();
+}
+/* Wait until the cycle counter reaches at, return the count it stopped at */
+uint32 UsDelay_Until(uint32 at)
+{
+    uint32 now;
+
+    do
+    {
+        now = Cycles_Now();
+    } while ((int32)(now - at) < 0);
+    return now;
+}
+/* Drop-in for CyDelayUs */
+void UsDelay(uint16 us)
+{
+    (void) UsDelay_Until(Cycles_Now() + UsDelay_Cycles(us));
+}
+/* Run USDELAY_RUNS chains of delays with interrupts enabled and count
+ * how much longer than planned each chain took in hist, 1 us per bin,
+ * the last bin holds everything longer. cyDelay 1 chains CyDelayUs,
+ * 0 chains deadlines. Blocks the caller, from the main loop only. */
+void UsDelay_Jitter(uint8 cyDelay, uint16 *hist)
+{
+    uint32 start, t, over;
+    uint16 run;
+    uint8 step;
+
+    memset(hist, 0, USDELAY_BINS * sizeof(hist[0]));
+    for (run = 0u; run < USDELAY_RUNS; run++)
+    {
+        start = t = Cycles_Now();
+        for (step = 0u; step < USDELAY_STEPS; step++)
+        {
+            if (cyDelay)
+            {
+                CyDelayUs(USDELAY_STEP_US);
+            }
+            else
+            {
+                t += UsDelay_Cycles(USDELAY_STEP_US);
+                (void) UsDelay_Until(t);
+            }
+        }
+        over = Cycles_Now() - start - UsDelay_Cycles(USDELAY_STEP_US * USDELAY_STEPS);
+        /* A chain that came out short counts as on time */
+        if ((int32)over < 0) over = 0u;
+        over /= cydelay_freq_mhz;
+        hist[over < USDELAY_BINS ? over : USDELAY_BINS - 1u]++;
+    }
+}
+/* Print the overrun histograms of CyDelayUs and the deadlines side by side */
+void UsDelay_Report(void (*out)(const char *s))
+{
+    uint16 cy[USDELAY_BINS], dl[USDELAY_BINS];
+    char buf[48];
+    uint8 i;
+
+    UsDelay_Jitter(1u, cy);
+    UsDelay_Jitter(0u, dl);
+    sprintf(buf, "%u x %u us late by  CyDelayUs  deadline\r\n", USDELAY_STEPS, USDELAY_STEP_US);
+    out(buf);
+    for (i = 0u; i < USDELAY_BINS; i++)
+    {
+        sprintf(buf, "%s%2u us %15u %9u\r\n", i == USDELAY_BINS - 1u ? ">=" : "  ", i, cy[i], dl[i]);
+        out(buf);
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,39 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Shared microsecond delays
+ * Waits on absolute deadlines of the free-running DWT cycle counter
+ * instead of counting loop iterations
+ *
+ * ========================================
+*/
+#ifndef USDELAY_H
+#define USDELAY_H
+
+#include <project.h>
+
+/* Jitter test: chains of USDELAY_STEPS delays of USDELAY_STEP_US, the
+ * overrun of each chain is counted in one of USDELAY_BINS 1 us bins */
+#define USDELAY_STEP_US     10u
+#define USDELAY_STEPS       8u
+#define USDELAY_RUNS        500u
+#define USDELAY_BINS        16u
+
+/* Cycles in us at the current CyDelay clock */
+#define UsDelay_Cycles(us)  ((uint32)(us) * cydelay_freq_mhz)
+
+void UsDelay_Start(void);
+uint32 UsDelay_Now(void);
+uint32 UsDelay_Until(uint32 at);
+void UsDelay(uint16 us);
+void UsDelay_Jitter(uint8 cyDelay, uint16 *hist);
+void UsDelay_Report(void (*out)(const char *s));
+
+#endif /* USDELAY_H */
+
+/* [] END OF FILE */
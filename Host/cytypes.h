@@ -0,0 +1,45 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Host build support
+ * Minimal stand-in for the PSoC cytypes.h so shared code builds on Linux
+ * 
+ * ========================================
+*/
+#ifndef HOST_CYTYPES_H
+#define HOST_CYTYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t   int8;
+typedef int16_t  int16;
+typedef int32_t  int32;
+typedef int64_t  int64;
+typedef uint64_t uint64;
+typedef unsigned char CYBIT;
+
+typedef volatile uint8  reg8;
+typedef volatile uint16 reg16;
+typedef volatile uint32 reg32;
+
+#define CY_NOINIT
+#define CYCODE
+#define CY_SECTION(name)
+#define CY_ALIGN(align)     __attribute__ ((aligned(align)))
+#define CY_INLINE           inline
+
+#define CY_ISR(FuncName)        void FuncName (void)
+#define CY_ISR_PROTO(FuncName)  void FuncName (void)
+
+#endif /* HOST_CYTYPES_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,101 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Host test of the event queue in Common/evq.c
+ * Threads stand in for interrupts of different priorities and post
+ * numbered events as fast as they can while the main thread takes them.
+ * Every event a poster got accepted must come out once and in the
+ * order it was posted, every rejected one must be counted.
+ * Build: gcc -O2 -pthread -I. -I../Common evq_test.c ../Common/evq.c -o evq_test
+ *
+ * ========================================
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "project.h"
+#include "evq.h"
+
+#define POSTERS     3
+#define EVENTS      200000u
+
+static EventQueue queue;
+/* Per poster: which events were accepted */
+static uint8 accepted[POSTERS][EVENTS];
+static volatile int running, finished;
+
+static void *Poster(void *p)
+{
+    uint16 id = (uint16)(long)p;
+    uint32 n;
+
+    while (!running) {}
+    for (n = 0; n < EVENTS; n++)
+    {
+        accepted[id][n] = EvQ_Post(&queue, 1u, id, n) == 0;
+        /* Bursts of 16, then let the others run */
+        if (n % 16u == 15u) sched_yield();
+    }
+    __atomic_add_fetch(&finished, 1, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t th[POSTERS];
+    uint32 next[POSTERS] = { 0 }, got = 0, want = 0, dropped = 0;
+    int i, errors = 0, last;
+    Event ev;
+
+    EvQ_Init(&queue);
+    for (i = 0; i < POSTERS; i++) pthread_create(&th[i], NULL, Poster, (void *)(long)i);
+    running = 1;
+    do
+    {
+        /* Once every poster is done, one more pass empties the queue */
+        last = __atomic_load_n(&finished, __ATOMIC_SEQ_CST) == POSTERS;
+        if (!EvQ_Get(&queue, &ev))
+        {
+            sched_yield();
+            continue;
+        }
+        do
+        {
+            /* Skip the ones this poster had rejected */
+            while (next[ev.arg] < EVENTS && !accepted[ev.arg][next[ev.arg]] && next[ev.arg] < ev.data)
+                next[ev.arg]++;
+            if (ev.data != next[ev.arg])
+            {
+                if (errors++ < 5) printf("poster %u: got %lu, expected %lu\n", ev.arg,
+                                         (unsigned long)ev.data, (unsigned long)next[ev.arg]);
+                next[ev.arg] = ev.data;
+            }
+            next[ev.arg]++;
+            got++;
+        } while (EvQ_Get(&queue, &ev));
+    } while (!last);
+    for (i = 0; i < POSTERS; i++) pthread_join(th[i], NULL);
+    for (i = 0; i < POSTERS; i++)
+    {
+        uint32 n;
+        for (n = 0; n < EVENTS; n++)
+        {
+            if (accepted[i][n]) want++;
+            else dropped++;
+        }
+    }
+    printf("posted %lu, taken %lu, accepted %lu, dropped %lu (counted %lu), deepest %lu\n",
+           (unsigned long)queue.posted, (unsigned long)got, (unsigned long)want,
+           (unsigned long)dropped, (unsigned long)queue.overflows, (unsigned long)queue.maxDepth);
+    if (got != want || dropped != queue.overflows || queue.posted != want) errors++;
+    printf(errors ? "FAIL\n" : "PASS\n");
+    return errors != 0;
+}
+
+/* [] END OF FILE */
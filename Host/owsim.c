@@ -0,0 +1,462 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Host simulation of the OneWireD pin and a bus of DS18B20 sensors
+ * The devices decode each slot from the length of the low pulse the
+ * master drives, as the real parts do, so the driver timing is checked
+ * and not only the byte sequence.
+ * 
+ * ========================================
+*/
+#include <stdio.h>
+#include "project.h"
+#include "owsim.h"
+
+/* Device states */
+#define S_IDLE      0   /* wait for reset */
+#define S_ROM       1   /* receive ROM command */
+#define S_MATCH     2   /* receive ROM to match */
+#define S_SEARCH    3   /* ROM search, 3 slots per bit */
+#define S_FUNC      4   /* receive function command */
+#define S_TX        5   /* send buf */
+#define S_WRITE_SP  6   /* receive TH, TL, config */
+#define S_CONVERT   7   /* read slots return conversion status */
+
+/* Slot decoding, in ns */
+#define RESET_STD   400000ull   /* low longer than this resets every device */
+#define RESET_OD    40000ull    /* overdrive reset */
+#define BIT_STD     15000ull    /* shorter low is a 1 */
+#define BIT_OD      3000ull
+#define LOG_RESET   65000ull    /* shortest low counted as a reset in the log */
+#define LOG_FAST    5000ull     /* only overdrive slots are shorter */
+/* Answers of the devices, in ns */
+#define HOLD_STD    30000ull    /* low time of a 0 read slot */
+#define HOLD_OD     3000ull
+#define PD_WAIT_STD 30000ull    /* presence pulse */
+#define PD_LOW_STD  120000ull
+#define PD_WAIT_OD  3000ull
+#define PD_LOW_OD   12000ull
+/* 12 bit conversion time */
+#define CONV_NS     750000000ull
+
+OwSimDevice OwSimDevices[OWSIM_MAX_DEVICES];
+int OwSimCount;
+OwSimTransaction OwSimLog[OWSIM_MAX_LOG];
+int OwSimLogCount;
+unsigned long OwSimPinNs = 250;
+
+/* CyLib delay clock */
+uint32 cydelay_freq_hz = 24000000u;
+uint8  cydelay_freq_mhz = 24u;
+
+static unsigned long long now;          /* virtual time, ns */
+static unsigned long long cpu;          /* time spent in driver calls */
+static unsigned long long lastActive;   /* end of the last driver call */
+static unsigned long long fallTime;     /* last master falling edge */
+static unsigned long long fallActive;   /* lastActive before that edge */
+static unsigned long long fallCpu;      /* cpu at that edge */
+static unsigned long long txnCpu;       /* cpu at the start of the open transaction */
+static int txnOpen;
+static int master = 1;                  /* level the master drives */
+static unsigned long long holdStart[OWSIM_MAX_DEVICES];
+
+/* Dallas CRC, bit by bit so the model does not share code with the driver */
+static unsigned char SimCrc(const unsigned char *p, int len)
+{
+    unsigned char crc = 0;
+    int i;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++) crc = (crc & 1) ? (crc >> 1) ^ 0x8C : crc >> 1;
+    }
+    return crc;
+}
+static void Advance(unsigned long long ns)
+{
+    now += ns;
+    cpu += ns;
+    lastActive = now;
+}
+/* Finish a pending conversion once its time is over */
+static void Convert(OwSimDevice *d)
+{
+    int bits;
+
+    if (d->convEnd == 0 || now < d->convEnd) return;
+    bits = ((d->scratch[4] >> 5) & 3) + 9;
+    d->scratch[0] = (unsigned char)(d->tempQ4 & ~((1 << (12 - bits)) - 1));
+    d->scratch[1] = (unsigned char)((d->tempQ4 & ~((1 << (12 - bits)) - 1)) >> 8);
+    d->convEnd = 0;
+}
+/* Bit the device puts on the bus in this slot, -1 if it only listens */
+static int TxBit(OwSimDevice *d)
+{
+    int bit;
+
+    switch (d->state)
+    {
+        case S_TX:
+            return (d->buf[d->count] >> d->bits) & 1;
+        case S_SEARCH:
+            if (d->search % 3 == 2) return -1;
+            bit = (d->rom[(d->search / 3) >> 3] >> ((d->search / 3) & 7)) & 1;
+            return (d->search % 3) ? !bit : bit;
+        case S_CONVERT:
+            return d->convEnd == 0;
+        default:
+            return -1;
+    }
+}
+static void RomCommand(OwSimDevice *d, unsigned char cmd)
+{
+    d->count = 0;
+    switch (cmd)
+    {
+        case 0x33:  /* Read ROM */
+            memcpy(d->buf, d->rom, 8);
+            d->len = 8;
+            d->state = S_TX;
+            break;
+        case 0x55:  /* Match ROM */
+            d->state = S_MATCH;
+            break;
+        case 0xCC:  /* Skip ROM */
+            d->state = S_FUNC;
+            break;
+        case 0xF0:  /* Search ROM */
+            d->search = 0;
+            d->state = S_SEARCH;
+            break;
+        case 0x3C:  /* Overdrive Skip ROM */
+            d->fast = d->overdrive;
+            d->state = d->overdrive ? S_FUNC : S_IDLE;
+            break;
+        case 0x69:  /* Overdrive Match ROM */
+            d->fast = d->overdrive;
+            d->state = d->overdrive ? S_MATCH : S_IDLE;
+            break;
+        default:
+            d->state = S_IDLE;
+            break;
+    }
+}
+static void FunctionCommand(OwSimDevice *d, unsigned char cmd)
+{
+    int bits;
+
+    d->count = 0;
+    switch (cmd)
+    {
+        case 0x44:  /* Convert T */
+            bits = ((d->scratch[4] >> 5) & 3) + 9;
+            d->convEnd = now + (CONV_NS >> (12 - bits));
+            d->state = S_CONVERT;
+            break;
+        case 0xBE:  /* Read Scratchpad */
+            Convert(d);
+            d->scratch[8] = SimCrc(d->scratch, 8);
+            memcpy(d->buf, d->scratch, 9);
+            d->len = 9;
+            d->state = S_TX;
+            break;
+        case 0x4E:  /* Write Scratchpad */
+            d->state = S_WRITE_SP;
+            break;
+        case 0x48:  /* Copy Scratchpad */
+            memcpy(d->eeprom, &d->scratch[2], 3);
+            d->state = S_IDLE;
+            break;
+        case 0xB8:  /* Recall E2 */
+            memcpy(&d->scratch[2], d->eeprom, 3);
+            d->state = S_IDLE;
+            break;
+        default:
+            d->state = S_IDLE;
+            break;
+    }
+}
+static void RxByte(OwSimDevice *d, unsigned char b)
+{
+    switch (d->state)
+    {
+        case S_ROM:
+            RomCommand(d, b);
+            break;
+        case S_MATCH:
+            /* A device that does not match goes back to standard speed */
+            if (b != d->rom[d->count])
+            {
+                d->fast = 0;
+                d->state = S_IDLE;
+            }
+            else if (++d->count == 8) d->state = S_FUNC;
+            break;
+        case S_FUNC:
+            FunctionCommand(d, b);
+            break;
+        case S_WRITE_SP:
+            /* Only R1 R0 of the configuration are writable */
+            d->scratch[2 + d->count] = (d->count == 2) ? ((b & 0x60) | 0x1F) : b;
+            if (++d->count == 3) d->state = S_IDLE;
+            break;
+    }
+}
+/* Slot seen by one device, bit is what it decoded from the low time */
+static void Slot(OwSimDevice *d, int bit)
+{
+    int rom;
+
+    switch (d->state)
+    {
+        case S_ROM:
+        case S_MATCH:
+        case S_FUNC:
+        case S_WRITE_SP:
+            d->shift |= (unsigned char)(bit << d->bits);
+            if (++d->bits == 8)
+            {
+                RxByte(d, d->shift);
+                d->shift = 0;
+                d->bits = 0;
+            }
+            break;
+        case S_TX:
+            if (++d->bits == 8)
+            {
+                d->bits = 0;
+                if (++d->count == d->len) d->state = S_IDLE;
+            }
+            break;
+        case S_SEARCH:
+            if (d->search % 3 == 2)
+            {
+                rom = (d->rom[(d->search / 3) >> 3] >> ((d->search / 3) & 7)) & 1;
+                /* Devices that do not match the direction drop out */
+                if (bit != rom) d->state = S_IDLE;
+            }
+            if (++d->search == 64 * 3 && d->state == S_SEARCH)
+            {
+                d->bits = 0;
+                d->shift = 0;
+                d->state = S_FUNC;
+            }
+            break;
+    }
+}
+static void Fall(void)
+{
+    int i;
+    OwSimDevice *d;
+
+    fallActive = lastActive;
+    fallTime = now;
+    fallCpu = cpu;
+    for (i = 0; i < OwSimCount; i++)
+    {
+        d = &OwSimDevices[i];
+        Convert(d);
+        /* A 0 is sent by holding the bus low past the sample point */
+        if (TxBit(d) == 0)
+        {
+            holdStart[i] = now;
+            d->holdEnd = now + (d->fast ? HOLD_OD : HOLD_STD);
+        }
+    }
+}
+static void CloseTransaction(unsigned long long end, unsigned long long endCpu)
+{
+    OwSimTransaction *t;
+
+    if (!txnOpen) return;
+    txnOpen = 0;
+    if (OwSimLogCount >= OWSIM_MAX_LOG) return;
+    t = &OwSimLog[OwSimLogCount++];
+    t->busNs = end - t->start;
+    t->cpuNs = endCpu - txnCpu;
+}
+static void Rise(void)
+{
+    unsigned long long low = now - fallTime;
+    OwSimDevice *d;
+    int i;
+
+    if (low >= LOG_RESET)
+    {
+        CloseTransaction(fallActive, fallCpu);
+        if (OwSimLogCount < OWSIM_MAX_LOG)
+        {
+            OwSimLog[OwSimLogCount].start = fallTime;
+            OwSimLog[OwSimLogCount].slots = 0;
+            OwSimLog[OwSimLogCount].overdrive = 0;
+            txnCpu = fallCpu;
+            txnOpen = 1;
+        }
+    }
+    else if (txnOpen && OwSimLogCount < OWSIM_MAX_LOG)
+    {
+        OwSimLog[OwSimLogCount].slots++;
+        if (low < LOG_FAST) OwSimLog[OwSimLogCount].overdrive = 1;
+    }
+
+    for (i = 0; i < OwSimCount; i++)
+    {
+        d = &OwSimDevices[i];
+        if (low >= RESET_STD || (d->fast && low >= RESET_OD))
+        {
+            if (low >= RESET_STD) d->fast = 0;
+            d->state = S_ROM;
+            d->bits = 0;
+            d->shift = 0;
+            /* Presence pulse */
+            holdStart[i] = now + (d->fast ? PD_WAIT_OD : PD_WAIT_STD);
+            d->holdEnd = holdStart[i] + (d->fast ? PD_LOW_OD : PD_LOW_STD);
+        }
+        else Slot(d, low < (d->fast ? BIT_OD : BIT_STD));
+    }
+}
+
+/* Pin */
+void OneWireD_Write(uint8 value)
+{
+    Advance(OwSimPinNs);
+    value = value ? 1 : 0;
+    if (value == master) return;
+    master = value;
+    if (value) Rise();
+    else Fall();
+}
+uint8 OneWireD_Read(void)
+{
+    int i;
+
+    Advance(OwSimPinNs);
+    if (!master) return 0;
+    for (i = 0; i < OwSimCount; i++)
+    {
+        if (now >= holdStart[i] && now < OwSimDevices[i].holdEnd) return 0;
+    }
+    return 1;
+}
+
+/* CyLib */
+void CyDelayCycles(uint32 cycles)
+{
+    Advance((unsigned long long)cycles * 1000u / cydelay_freq_mhz);
+}
+void CyDelayUs(uint16 microseconds)
+{
+    Advance((unsigned long long)microseconds * 1000u);
+}
+void CyDelay(uint32 milliseconds)
+{
+    Advance((unsigned long long)milliseconds * 1000000u);
+}
+void CyDelayFreq(uint32 freq)
+{
+    cydelay_freq_hz = freq ? freq : 24000000u;
+    cydelay_freq_mhz = (uint8)((cydelay_freq_hz + 999999u) / 1000000u);
+}
+/* UsDelay, the cycle counter runs on virtual time */
+uint32 UsDelay_Now(void)
+{
+    return (uint32)(now * cydelay_freq_mhz / 1000u);
+}
+uint32 UsDelay_Until(uint32 at)
+{
+    int32 left = (int32)(at - UsDelay_Now());
+
+    if (left > 0) Advance(((unsigned long long)left * 1000u + cydelay_freq_mhz - 1u) / cydelay_freq_mhz);
+    return UsDelay_Now();
+}
+uint8 CyEnterCriticalSection(void)
+{
+    return 0;
+}
+void CyExitCriticalSection(uint8 savedIntrStatus)
+{
+    (void)savedIntrStatus;
+}
+
+/* Simulator control */
+void OwSimReset(void)
+{
+    memset(OwSimDevices, 0, sizeof(OwSimDevices));
+    memset(holdStart, 0, sizeof(holdStart));
+    OwSimCount = 0;
+    OwSimLogCount = 0;
+    now = cpu = lastActive = 0;
+    txnOpen = 0;
+    master = 1;
+}
+/* Add a DS18B20 with the given 48-bit serial, its ROM gets family 0x28
+ * and the CRC. Power-up scratchpad: 85 degree, 12 bits. */
+OwSimDevice *OwSimAdd(unsigned long long serial, int tempQ4, int overdrive)
+{
+    OwSimDevice *d;
+    int i;
+
+    if (OwSimCount >= OWSIM_MAX_DEVICES) return NULL;
+    d = &OwSimDevices[OwSimCount++];
+    memset(d, 0, sizeof(*d));
+    d->rom[0] = 0x28;
+    for (i = 0; i < 6; i++) d->rom[1 + i] = (unsigned char)(serial >> (8 * i));
+    d->rom[7] = SimCrc(d->rom, 7);
+    d->tempQ4 = tempQ4;
+    d->overdrive = overdrive;
+    d->eeprom[0] = 0x4B;
+    d->eeprom[1] = 0x46;
+    d->eeprom[2] = 0x7F;
+    d->scratch[0] = 0x50;
+    d->scratch[1] = 0x05;
+    memcpy(&d->scratch[2], d->eeprom, 3);
+    d->scratch[5] = 0xFF;
+    d->scratch[6] = 0x0C;
+    d->scratch[7] = 0x10;
+    return d;
+}
+unsigned long long OwSimNow(void)
+{
+    return now;
+}
+/* Time passing outside the driver, the CPU is free */
+void OwSimIdle(unsigned long long ns)
+{
+    now += ns;
+}
+void OwSimClearLog(void)
+{
+    txnOpen = 0;
+    OwSimLogCount = 0;
+}
+/* Close the open transaction so it shows up in the log */
+void OwSimFlush(void)
+{
+    CloseTransaction(lastActive, cpu);
+}
+void OwSimPrintLog(const char *title)
+{
+    unsigned long long bus = 0, blocked = 0;
+    int i;
+
+    OwSimFlush();
+    printf("%s\n", title);
+    printf("  %-4s %12s %10s %10s %6s %s\n", "#", "start us", "bus us", "cpu us", "slots", "speed");
+    for (i = 0; i < OwSimLogCount; i++)
+    {
+        printf("  %-4d %12.1f %10.1f %10.1f %6d %s\n", i,
+               OwSimLog[i].start / 1e3, OwSimLog[i].busNs / 1e3, OwSimLog[i].cpuNs / 1e3,
+               OwSimLog[i].slots, OwSimLog[i].overdrive ? "overdrive" : "standard");
+        bus += OwSimLog[i].busNs;
+        blocked += OwSimLog[i].cpuNs;
+    }
+    printf("  total bus %.1f us, cpu blocked %.1f us\n", bus / 1e3, blocked / 1e3);
+}
+
+/* [] END OF FILE */
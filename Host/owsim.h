@@ -0,0 +1,72 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Host simulation of the OneWireD pin and a bus of DS18B20 sensors
+ * Time is virtual, it only moves in the delay calls, the pin accesses
+ * and OwSimIdle.
+ * 
+ * ========================================
+*/
+#ifndef OWSIM_H
+#define OWSIM_H
+
+#include "cytypes.h"
+
+#define OWSIM_MAX_DEVICES   64
+#define OWSIM_MAX_LOG       256
+
+/* Device model, the fields above the line are set by the test */
+typedef struct
+{
+    unsigned char rom[8];
+    int tempQ4;                 /* temperature in 1/16 degree */
+    int overdrive;              /* device supports the overdrive commands */
+    /* ---- internal state ---- */
+    unsigned char scratch[9];
+    unsigned char eeprom[3];
+    int state;
+    int fast;                   /* currently at overdrive speed */
+    unsigned char shift;
+    int bits;
+    int count;
+    unsigned char buf[9];
+    int len;
+    int search;
+    unsigned long long convEnd;
+    unsigned long long holdEnd; /* end of the low pulse the device drives */
+} OwSimDevice;
+
+/* One transaction: from a reset pulse to the last driver activity
+ * before the next one */
+typedef struct
+{
+    unsigned long long start;   /* ns */
+    unsigned long long busNs;   /* time span on the bus */
+    unsigned long long cpuNs;   /* time the CPU was blocked in the driver */
+    int slots;
+    int overdrive;              /* some slots ran at overdrive speed */
+} OwSimTransaction;
+
+extern OwSimDevice OwSimDevices[OWSIM_MAX_DEVICES];
+extern int OwSimCount;
+extern OwSimTransaction OwSimLog[OWSIM_MAX_LOG];
+extern int OwSimLogCount;
+/* Cost of one OneWireD pin access, in ns */
+extern unsigned long OwSimPinNs;
+
+void OwSimReset(void);
+OwSimDevice *OwSimAdd(unsigned long long serial, int tempQ4, int overdrive);
+unsigned long long OwSimNow(void);
+void OwSimIdle(unsigned long long ns);
+void OwSimClearLog(void);
+void OwSimFlush(void);
+void OwSimPrintLog(const char *title);
+
+#endif /* OWSIM_H */
+
+/* [] END OF FILE */
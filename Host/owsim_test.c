@@ -0,0 +1,137 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Regression run of onewirelib.c against the simulated bus
+ * Build: gcc -O2 -I. -I../Common -I../QuangPSoC5OneWire.cydsn owsim_test.c owsim.c
+ *        ../QuangPSoC5OneWire.cydsn/onewirelib.c ../Common/crc8.c -o owsim_test
+ * The bus time budgets below fail the run if the driver gets slower.
+ * 
+ * ========================================
+*/
+#include <stdio.h>
+#include "owsim.h"
+#include "onewirelib.h"
+
+/* Bus time budgets, in us */
+#define BUDGET_READ_STD     12000   /* Match ROM + Read Scratchpad */
+#define BUDGET_READ_OD      3500    /* Overdrive Match ROM + Read Scratchpad */
+#define BUDGET_CONVERT_9    100000  /* 9 bit conversion until the poll sees it */
+
+static int failed;
+
+#define CHECK(cond, ...) do { if (!(cond)) { failed++; printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+                              printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+/* Index of a ROM in the simulator, -1 if unknown */
+static int FindRom(const unsigned char *rom)
+{
+    int i;
+
+    for (i = 0; i < OwSimCount; i++)
+        if (memcmp(OwSimDevices[i].rom, rom, OW_ROM_SIZE) == 0) return i;
+    return -1;
+}
+static unsigned long long LastBusUs(void)
+{
+    OwSimFlush();
+    return OwSimLogCount ? OwSimLog[OwSimLogCount - 1].busNs / 1000 : 0;
+}
+
+static void TestSearch(int n)
+{
+    int i, found;
+    unsigned char seen[OWSIM_MAX_DEVICES] = {0};
+
+    OwSimReset();
+    for (i = 0; i < n; i++) OwSimAdd(0x1000 + 37ull * i * i, 16 * i - 80, 0);
+    OWDevices.magic = 0;
+    found = OWEnumerate();
+    CHECK(found == (n < OW_MAX_DEVICES ? n : OW_MAX_DEVICES), "search found %d of %d", found, n);
+    CHECK(OWTableValid(), "table not valid after search");
+    for (i = 0; i < found; i++)
+    {
+        int dev = FindRom(OWDevices.rom[i]);
+        CHECK(dev >= 0 && !seen[dev], "device %d bad or repeated ROM", i);
+        if (dev >= 0) seen[dev] = 1;
+    }
+    printf("search %d devices: %.1f ms\n", n, OwSimNow() / 1e6);
+}
+
+static void TestConvert(int n, int bits)
+{
+    unsigned char sp[OW_SCRATCHPAD_SIZE];
+    unsigned long long t0, t;
+    int i, dev, want;
+
+    OwSimReset();
+    for (i = 0; i < n; i++) OwSimAdd(0x2000 + i, 16 * 25 + 7 * i - 3 * n, 0);
+    OWEnumerate();
+    CHECK(OWSetResolution(OW_ALL, bits) == 0, "no presence on resolution write");
+    OwSimClearLog();
+
+    CHECK(OWConvertAll() == 0, "no presence on convert");
+    t0 = OwSimNow();
+    do
+    {
+        OwSimIdle(1000000);
+    } while (!OWConversionDone() && OwSimNow() - t0 < 2000000000ull);
+    t = (OwSimNow() - t0) / 1000;
+    printf("convert %d devices at %d bits: done after %.1f ms, expected %d ms\n",
+           n, bits, t / 1e3, OWConversionTimeMs(bits));
+    /* One 1 ms poll period late at most, OWConversionTimeMs rounds down */
+    CHECK(t <= (unsigned long long)OWConversionTimeMs(bits) * 1000 + 2000, "conversion poll too late");
+    if (bits == 9) CHECK(t <= BUDGET_CONVERT_9, "9 bit conversion over budget");
+
+    for (i = 0; i < OWDevices.count; i++)
+    {
+        OwSimClearLog();
+        CHECK(OWReadScratchpad(i, sp) == 0, "device %d scratchpad CRC", i);
+        dev = FindRom(OWDevices.rom[i]);
+        want = OwSimDevices[dev].tempQ4 & ~((1 << (12 - bits)) - 1);
+        CHECK(OWTempFixed(sp) == want, "device %d temp %d, want %d", i, OWTempFixed(sp), want);
+        CHECK(LastBusUs() <= BUDGET_READ_STD, "standard read over budget");
+    }
+    printf("read %d devices: %.1f ms after the conversion\n", n, (OwSimNow() - t0) / 1e6 - t / 1e3);
+}
+
+static void TestOverdrive(void)
+{
+    unsigned char sp[OW_SCRATCHPAD_SIZE];
+    int i, dev;
+
+    OwSimReset();
+    for (i = 0; i < 6; i++) OwSimAdd(0x3000 + i, 400 + i, i & 1);
+    OWEnumerate();
+    for (i = 0; i < OWDevices.count; i++)
+    {
+        dev = FindRom(OWDevices.rom[i]);
+        CHECK(OWDevices.overdrive[i] == OwSimDevices[dev].overdrive, "device %d overdrive flag", i);
+        OwSimClearLog();
+        CHECK(OWReadScratchpad(i, sp) == 0, "device %d scratchpad CRC", i);
+        OwSimPrintLog(OWDevices.overdrive[i] ? "read scratchpad, overdrive" : "read scratchpad, standard");
+        if (OWDevices.overdrive[i])
+            CHECK(LastBusUs() <= BUDGET_READ_OD, "overdrive read over budget");
+    }
+    printf("byte time: standard %lu ns, overdrive %lu ns\n",
+           OWByteTimeNs(&OWStandard), OWByteTimeNs(&OWOverdrive));
+}
+
+int main(void)
+{
+    TestSearch(1);
+    TestSearch(10);
+    TestSearch(30);
+    TestConvert(1, 12);
+    TestConvert(10, 9);
+    TestConvert(30, 11);
+    TestOverdrive();
+    printf(failed ? "%d FAILED\n" : "all passed\n", failed);
+    return failed != 0;
+}
+
+/* [] END OF FILE */
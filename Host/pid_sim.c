@@ -0,0 +1,207 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Host simulation of the servo position loop
+ * A hobby servo with its own speed limited loop drives a loaded arm whose
+ * angle is read by a noisy 12 bit pot. ServoPID_Update runs on it at
+ * PID_RATE_HZ and the PWM only takes a new width every 20 ms, as on the
+ * rig. Checks step response, recovery from a stall and the relay
+ * auto-tune, then times one update. "pid_sim csv" prints the step trace.
+ * Build: gcc -O2 -I. -I../QuangvPSoC5Servo.cydsn pid_sim.c ../QuangvPSoC5Servo.cydsn/servopid.c -o pid_sim
+ *
+ * ========================================
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "project.h"
+#include "servopid.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define CYCLES() __rdtsc()
+#else
+    #define CYCLES() 0ull
+#endif
+
+/* Loop settings used on the rig */
+#define KP          PID_GAIN(0.3)
+#define KI          PID_GAIN(0.02)
+#define KD          PID_GAIN(1.0)
+#define DSHIFT      3
+#define OUT_MAX     300
+
+/* Plant, simulated in 1 ms steps */
+#define SIM_HZ      1000
+#define PWM_MS      20
+#define SERVO_VMAX  4.5         // us of width per ms, about 0.15 s / 60 deg
+#define SERVO_KV    0.08        // speed per us of error of the servo's own loop
+#define SERVO_TAU   8.0         // ms, motor speed lag
+#define SERVO_DEAD  3.0         // us, the servo ignores smaller errors
+#define POT_NOISE   3           // counts, peak
+#define TRACE_MAX   2000
+
+/* CyLib stand-ins */
+uint8 CyEnterCriticalSection(void) { return 0; }
+void CyExitCriticalSection(uint8 savedIntrStatus) { (void) savedIntrStatus; }
+
+typedef struct
+{
+    double s;           // servo position, us of width
+    double v;           // us per ms
+    double load;        // arm deflection under load, us
+    double stall;       // the arm cannot pass this width, 0 = free
+    uint16 cmd;         // width the servo is following
+    uint16 compare;     // width written by the loop
+} Plant;
+
+static int16 trace[TRACE_MAX];
+
+/* Pot on the arm: 1.024 counts per us around the middle */
+static int16 Plant_Pot(const Plant *pl)
+{
+    double y = pl->s - pl->load;
+    int c = (int)(2048.0 + (y - 1500.0) * 1.024) + rand() % (2 * POT_NOISE + 1) - POT_NOISE;
+
+    return (int16)(c < 0 ? 0 : c > 4095 ? 4095 : c);
+}
+static void Plant_Step(Plant *pl, int ms)
+{
+    double e, vt;
+
+    /* New width at the start of each PWM period */
+    if (ms % PWM_MS == 0) pl->cmd = pl->compare;
+    e = pl->cmd - pl->s;
+    vt = (e > SERVO_DEAD || e < -SERVO_DEAD) ? SERVO_KV * e : 0.0;
+    if (vt > SERVO_VMAX) vt = SERVO_VMAX;
+    if (vt < -SERVO_VMAX) vt = -SERVO_VMAX;
+    pl->v += (vt - pl->v) / SERVO_TAU;
+    pl->s += pl->v;
+    if (pl->stall > 0.0 && pl->s > pl->stall)
+    {
+        pl->s = pl->stall;
+        pl->v = 0.0;
+    }
+}
+/* Run the loop for ms milliseconds, keep the measured width every tick */
+static int Run(PID *pid, Plant *pl, int ms, int16 *out, int max)
+{
+    int t, n = 0;
+
+    for (t = 0; t < ms; t++)
+    {
+        if (t % (SIM_HZ / PID_RATE_HZ) == 0)
+        {
+            pl->compare = ServoPID_Update(pid, Plant_Pot(pl));
+            if (out && n < max) out[n++] = (int16)(pl->s - pl->load);
+        }
+        Plant_Step(pl, t);
+    }
+    return n;
+}
+static void Plant_Init(Plant *pl, double pos, double load)
+{
+    memset(pl, 0, sizeof(*pl));
+    pl->s = pos + load;
+    pl->load = load;
+    pl->cmd = pl->compare = (uint16)pos;
+}
+/* Settle at 1500, step to 2000, report overshoot and the remaining error */
+static int Step(PID *pid, const char *name, int csv)
+{
+    Plant pl;
+    int n, i, peak = 0, err;
+
+    Plant_Init(&pl, 1500, 40);
+    ServoPID_SetPoint(pid, 1500);
+    Run(pid, &pl, 1000, NULL, 0);
+    ServoPID_SetPoint(pid, 2000);
+    n = Run(pid, &pl, 1500, trace, TRACE_MAX);
+    for (i = 0; i < n; i++) if (trace[i] > peak) peak = trace[i];
+    err = 2000 - (int)(pl.s - pl.load);
+    if (csv)
+    {
+        for (i = 0; i < n; i++) printf("%d,%d\n", i, trace[i]);
+        return 0;
+    }
+    printf("%-10s kp %5.2f ki %6.3f kd %5.2f  overshoot %3d us  error %3d us  saturated %lu\n",
+           name, pid->kp / 256.0, pid->ki / 256.0, pid->kd / 256.0,
+           peak > 2000 ? peak - 2000 : 0, err, (unsigned long)pid->saturated);
+    return err > 6 || err < -6;
+}
+int main(int argc, char **argv)
+{
+    PID pid;
+    Plant pl;
+    int fail = 0, i, peak, err;
+    int32 kp, ki, kd;
+    unsigned long long c0, total = 0;
+
+    srand(1);
+    ServoPID_Init(&pid, 1500, KP, KI, KD, DSHIFT, OUT_MAX);
+    ServoPID_Calibrate(&pid, (int16)(2048 - 512), (int16)(2048 + 512));
+    if (argc > 1 && strcmp(argv[1], "csv") == 0) return Step(&pid, "", 1);
+
+    /* Open loop for reference: the load stays as an error */
+    ServoPID_SetGains(&pid, 0, 0, 0);
+    Step(&pid, "open", 0);
+    ServoPID_SetGains(&pid, KP, KI, KD);
+    fail |= Step(&pid, "default", 0);
+
+    /* Arm blocked at 1960 for 2 s while asked for 2000, then let go */
+    Plant_Init(&pl, 1500, 40);
+    ServoPID_SetGains(&pid, KP, KI, KD);
+    ServoPID_SetPoint(&pid, 2000);
+    pl.stall = 1960 + pl.load;
+    Run(&pid, &pl, 2000, NULL, 0);
+    printf("stall      integral %d us of %d, saturated %lu ticks\n",
+           (int)(pid.integ >> PID_Q), OUT_MAX, (unsigned long)pid.saturated);
+    pl.stall = 0.0;
+    i = Run(&pid, &pl, 1500, trace, TRACE_MAX);
+    for (peak = 0; i > 0; i--) if (trace[i - 1] > peak) peak = trace[i - 1];
+    err = 2000 - (int)(pl.s - pl.load);
+    printf("release    overshoot %d us, error %d us\n", peak > 2000 ? peak - 2000 : 0, err);
+    /* The integral is held at the limit, so it unwinds in bounded time */
+    fail |= peak > 2000 + OUT_MAX || err > 6 || err < -6;
+
+    /* Relay test at 1500 */
+    Plant_Init(&pl, 1500, 40);
+    ServoPID_SetGains(&pid, KP, KI, KD);
+    ServoPID_SetPoint(&pid, 1500);
+    Run(&pid, &pl, 1000, NULL, 0);
+    ServoPID_AutoTune(&pid, 60, 4);
+    for (i = 0; i < 20 && pid.tune.state == PID_TUNE_RUNNING; i++) Run(&pid, &pl, 500, NULL, 0);
+    printf("auto-tune  tu %u ticks (%u ms), amplitude %d us\n", pid.tune.tu,
+           pid.tune.tu * 1000u / PID_RATE_HZ, pid.tune.amp);
+    if (ServoPID_TuneGains(&pid, &kp, &ki, &kd))
+    {
+        printf("auto-tune  FAILED\n");
+        fail = 1;
+    }
+    else
+    {
+        ServoPID_SetGains(&pid, kp, ki, kd);
+        fail |= Step(&pid, "tuned", 0);
+    }
+
+    /* Same work every tick, whatever the state. The target figure is
+     * PID_Cycles in the firmware, this only shows nothing grew a loop. */
+    for (i = 0; i < 100000; i++)
+    {
+        int16 counts = (int16)(rand() & 0xFFF);
+
+        c0 = CYCLES();
+        ServoPID_Update(&pid, counts);
+        total += CYCLES() - c0;
+    }
+    printf("update     %llu host cycles on average\n", total / 100000);
+    printf(fail ? "FAIL\n" : "PASS\n");
+    return fail;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,202 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Host run of Common/pmclk.c against a model of the clock tree
+ * The registers are the register file of regsim.c, the CyLib clock calls
+ * act on it and the PLL locks a while after it starts. Each clock tree is
+ * saved and restored, every register must come back as it was, and the
+ * register loads and stores and the wakeup time are reported.
+ * Build: gcc -O2 -I. -I../Common pmclk_sim.c regsim.c ../Common/pmclk.c -o pmclk_sim
+ *
+ * ========================================
+*/
+#include <stdio.h>
+#include "project.h"
+#include "regsim.h"
+#include "regclk.h"
+#include "pmclk.h"
+
+/* PLL lock after its start, ns */
+#define PLL_LOCK_NS     120000ull
+/* PLL multiplier of the DWR, 3 MHz IMO to 24 MHz */
+#define PLL_P           8u
+#define PLL_Q           1u
+
+/* CY_IMO_FREQ_x to the IMO_CR field, and the field to MHz */
+static const uint8 freqToField[7] = { 3u, 1u, 0u, 2u, 4u, 5u, 6u };
+static const uint8 fieldToMhz[7] = { 12u, 6u, 24u, 3u, 48u, 62u, 74u };
+
+static const uint32 tracked[] =
+{
+    REGCLK_CLKDIST_CR, REGCLK_CLKDIST_MSTR0, REGCLK_CLKDIST_MSTR1, REGCLK_CLKDIST_BCFG0,
+    REGCLK_CLKDIST_BCFG1, REGCLK_CLKDIST_DLY1, REGCLK_FASTCLK_IMO_CR, REGCLK_FASTCLK_XMHZ_CSR,
+    REGCLK_FASTCLK_PLL_CFG0, REGCLK_PM_ACT_CFG1, REGCLK_PM_ACT_CFG2, REGCLK_CACHE_CC_CTL,
+};
+#define TRACKED (sizeof(tracked) / sizeof(tracked[0]))
+
+static unsigned long long now;      /* virtual time, ns */
+static unsigned long long lockAt;   /* PLL locked from then on */
+static int cyCalls, cyPmCalls;
+static int errors;
+
+#define CHECK(cond, ...) do { if (!(cond)) { errors++; printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+                              printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+/* Model */
+static uint32 MasterMhz(void)
+{
+    uint32 mhz = fieldToMhz[RegSim_Peek(REGCLK_FASTCLK_IMO_CR) & 0x07u];
+
+    if ((RegSim_Peek(REGCLK_CLKDIST_MSTR1) & 0x03u) == CY_MASTER_SOURCE_PLL) mhz = mhz * PLL_P / PLL_Q;
+    return mhz / (RegSim_Peek(REGCLK_CLKDIST_MSTR0) + 1u);
+}
+static uint8 PllStatus(uint32 addr, uint8 value)
+{
+    (void)addr;
+    (void)value;
+    return (RegSim_Peek(REGCLK_FASTCLK_PLL_CFG0) & 0x01u) && now >= lockAt;
+}
+
+/* CyLib */
+void CyDelayCycles(uint32 cycles)
+{
+    now += (unsigned long long)cycles * 1000u / MasterMhz();
+}
+cystatus CyPLL_OUT_Start(uint8 wait)
+{
+    (void)wait;
+    cyCalls++;
+    RegSim_PokeField(REGCLK_FASTCLK_PLL_CFG0, 0x01u, 0x01u);
+    lockAt = now + PLL_LOCK_NS;
+    return CYRET_SUCCESS;
+}
+void CyPLL_OUT_Stop(void)
+{
+    cyCalls++;
+    RegSim_PokeField(REGCLK_FASTCLK_PLL_CFG0, 0x01u, 0x00u);
+}
+void CyIMO_SetFreq(uint8 freq)
+{
+    cyCalls++;
+    RegSim_PokeField(REGCLK_FASTCLK_IMO_CR, 0x07u, freqToField[freq]);
+}
+void CyMasterClk_SetSource(uint8 source)
+{
+    cyCalls++;
+    /* The real call waits for the PLL, the model only checks it */
+    CHECK(source != CY_MASTER_SOURCE_PLL || PllStatus(0u, 0u), "master clock to an unlocked PLL");
+    RegSim_PokeField(REGCLK_CLKDIST_MSTR1, 0x03u, source);
+}
+void CyMasterClk_SetDivider(uint8 divider)
+{
+    cyCalls++;
+    RegSim_Poke(REGCLK_CLKDIST_MSTR0, divider);
+}
+void CyBusClk_SetDivider(uint16 divider)
+{
+    cyCalls++;
+    RegSim_Poke(REGCLK_CLKDIST_BCFG0, (uint8)divider);
+    RegSim_Poke(REGCLK_CLKDIST_BCFG1, (uint8)(divider >> 8));
+}
+void CyFlash_SetWaitCycles(uint8 freq)
+{
+    cyCalls++;
+    RegSim_PokeField(REGCLK_CACHE_CC_CTL, 0xC0u, (uint8)((freq <= 22u ? 1u : freq <= 44u ? 2u : 3u) << 6));
+}
+void CyPmSaveClocks(void)
+{
+    cyPmCalls++;
+}
+void CyPmRestoreClocks(void)
+{
+    cyPmCalls++;
+}
+
+/* Load a clock tree: IMO_CR, PLL on, master source, delay line on */
+static void Tree(uint8 imoCr, uint8 pll, uint8 source, uint8 xtal)
+{
+    RegSim_Reset();
+    RegSim_Hook(REGCLK_FASTCLK_PLL_SR, PllStatus, NULL);
+    RegSim_Poke(REGCLK_CLKDIST_CR, 0x00u);
+    RegSim_Poke(REGCLK_CLKDIST_MSTR0, 0x00u);
+    RegSim_Poke(REGCLK_CLKDIST_MSTR1, source);
+    RegSim_Poke(REGCLK_CLKDIST_BCFG0, 0x00u);
+    RegSim_Poke(REGCLK_CLKDIST_BCFG1, 0x00u);
+    RegSim_Poke(REGCLK_CLKDIST_DLY1, 0x04u);
+    RegSim_Poke(REGCLK_FASTCLK_IMO_CR, imoCr);
+    RegSim_Poke(REGCLK_FASTCLK_XMHZ_CSR, xtal);
+    RegSim_Poke(REGCLK_FASTCLK_PLL_CFG0, pll);
+    /* Upper bits of ACT_CFG1 are not clocks and must survive */
+    RegSim_Poke(REGCLK_PM_ACT_CFG1, 0x35u);
+    RegSim_Poke(REGCLK_PM_ACT_CFG2, 0xA5u);
+    RegSim_Poke(REGCLK_CACHE_CC_CTL, 0x81u);
+    lockAt = pll ? 0u : ~0ull;
+}
+static void Run(const char *name, uint8 imoCr, uint8 pll, uint8 source, uint8 xtal)
+{
+    uint8 before[TRACKED];
+    uint32 loads, stores;
+    unsigned long long start;
+    unsigned i;
+
+    Tree(imoCr, pll, source, xtal);
+    for (i = 0; i < TRACKED; i++) before[i] = RegSim_Peek(tracked[i]);
+    cyCalls = cyPmCalls = 0;
+
+    PmClk_Save();
+    loads = RegSim_Loads;
+    stores = RegSim_Stores;
+    if (!xtal)
+    {
+        CHECK((RegSim_Peek(REGCLK_CLKDIST_MSTR1) & 0x03u) == CY_MASTER_SOURCE_IMO, "%s: master clock not on the IMO", name);
+        CHECK(!(RegSim_Peek(REGCLK_FASTCLK_PLL_CFG0) & 0x01u), "%s: PLL still on", name);
+        CHECK((RegSim_Peek(REGCLK_FASTCLK_IMO_CR) & 0x07u) == freqToField[CY_PM_IMO_FREQ_LPM], "%s: IMO not at the sleep frequency", name);
+        CHECK(RegSim_Peek(REGCLK_PM_ACT_CFG1) == 0x30u && RegSim_Peek(REGCLK_PM_ACT_CFG2) == 0u, "%s: clocks still enabled", name);
+    }
+    /* CyPmSleep wakes with the PLL stopped, the generated restore
+     * brings it back on its own */
+    if (!xtal) RegSim_PokeField(REGCLK_FASTCLK_PLL_CFG0, 0x01u, 0x00u);
+
+    RegSim_Loads = RegSim_Stores = 0;
+    start = now;
+    PmClk_Restore();
+    for (i = 0; i < TRACKED; i++)
+    {
+        CHECK(RegSim_Peek(tracked[i]) == before[i], "%s: register 0x%08X is 0x%02X, was 0x%02X",
+              name, (unsigned)tracked[i], RegSim_Peek(tracked[i]), before[i]);
+    }
+    CHECK(cyPmCalls == (xtal ? 2 : 0), "%s: %d generated calls", name, cyPmCalls);
+    printf("%-12s save %2u loads %2u stores, restore %2u loads %2u stores %6.1f us, %d CyLib calls\n",
+           name, (unsigned)loads, (unsigned)stores, (unsigned)RegSim_Loads, (unsigned)RegSim_Stores,
+           (now - start) / 1000.0, cyCalls);
+}
+
+int main(void)
+{
+    /* The layer itself: a field write and two fields in one modify are
+     * one load and one store each */
+    RegSim_Reset();
+    Field8_Set(FLD_CACHE_WAIT, 2u);
+    Reg8_Modify(REG_FASTCLK_IMO_CR, FLD_IMO_FREQ.mask | FLD_IMO_USB.mask,
+                Field8_Val(FLD_IMO_FREQ, 4u) | Field8_Val(FLD_IMO_USB, 1u));
+    CHECK(RegSim_Loads == 2u && RegSim_Stores == 2u, "%u loads %u stores for two modifies",
+          (unsigned)RegSim_Loads, (unsigned)RegSim_Stores);
+    CHECK(RegSim_Peek(REGCLK_CACHE_CC_CTL) == 0x80u && RegSim_Peek(REGCLK_FASTCLK_IMO_CR) == 0x44u, "modify values");
+
+    /* Ex1 DWR: 3 MHz IMO, PLL to 24 MHz */
+    Run("IMO+PLL", 0x03u, 0x01u, CY_MASTER_SOURCE_PLL, 0u);
+    /* 24 MHz IMO alone */
+    Run("IMO", 0x02u, 0x00u, CY_MASTER_SOURCE_IMO, 0u);
+    /* A crystal goes to the generated functions and nothing is touched */
+    Run("XTAL", 0x03u, 0x01u, CY_MASTER_SOURCE_PLL, 0x01u);
+
+    printf(errors ? "FAIL\n" : "PASS\n");
+    return errors != 0;
+}
+
+/* [] END OF FILE */
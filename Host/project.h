@@ -0,0 +1,74 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Host build support
+ * Stand-in for the generated project.h: the CyLib delay and interrupt
+ * calls and the OneWireD pin, implemented by the simulator in owsim.c,
+ * and the clock calls, implemented by the clock model in pmclk_sim.c
+ * 
+ * ========================================
+*/
+#ifndef HOST_PROJECT_H
+#define HOST_PROJECT_H
+
+#include <string.h>
+#include "cytypes.h"
+
+/* CyLib.h */
+extern uint32 cydelay_freq_hz;
+extern uint8  cydelay_freq_mhz;
+void CyDelay(uint32 milliseconds);
+void CyDelayUs(uint16 microseconds);
+void CyDelayCycles(uint32 cycles);
+void CyDelayFreq(uint32 freq);
+uint8 CyEnterCriticalSection(void);
+void CyExitCriticalSection(uint8 savedIntrStatus);
+#define CyGlobalIntEnable   do { } while (0)
+#define CyGlobalIntDisable  do { } while (0)
+
+/* bitpin.h: no bit-band here, the pins go through the simulator */
+#define BITPIN_HOST
+/* reg.h: registers live in the register file of regsim.c */
+#define REG_HOST
+
+/* CyLib.h, CyFlash.h and cyPm.h clock calls */
+#define CYRET_SUCCESS       0x00u
+#define CY_IMO_FREQ_3MHZ    0u
+#define CY_IMO_FREQ_6MHZ    1u
+#define CY_IMO_FREQ_12MHZ   2u
+#define CY_IMO_FREQ_24MHZ   3u
+#define CY_IMO_FREQ_48MHZ   4u
+#define CY_IMO_FREQ_62MHZ   5u
+#define CY_IMO_FREQ_74MHZ   6u
+#define CY_MASTER_SOURCE_IMO    0u
+#define CY_MASTER_SOURCE_PLL    1u
+#define CY_PM_IMO_FREQ_LPM      CY_IMO_FREQ_48MHZ
+#define CY_PM_DIV_BY_ONE        0x00u
+#define CY_PM_BUS_CLK_DIV_BY_ONE    0x00u
+#define CY_PM_MAX_FLASH_WAIT_CYCLES 55u
+#define CY_PM_PLL_OUT_NO_WAIT   0u
+#define CY_PM_CLK_DELAY_BANDGAP_SETTLE_US   50u
+#define CY_PM_CLK_DELAY_BIAS_SETTLE_US      25u
+typedef uint32 cystatus;
+cystatus CyPLL_OUT_Start(uint8 wait);
+void CyPLL_OUT_Stop(void);
+void CyIMO_SetFreq(uint8 freq);
+void CyMasterClk_SetSource(uint8 source);
+void CyMasterClk_SetDivider(uint8 divider);
+void CyBusClk_SetDivider(uint16 divider);
+void CyFlash_SetWaitCycles(uint8 freq);
+void CyPmSaveClocks(void);
+void CyPmRestoreClocks(void);
+
+/* OneWireD.h */
+void OneWireD_Write(uint8 value);
+uint8 OneWireD_Read(void);
+
+#endif /* HOST_PROJECT_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,97 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Host register file for Common/reg.h
+ * Holds every register a driver touches, counts its loads and stores
+ * and lets a model answer reads and follow writes
+ *
+ * ========================================
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "regsim.h"
+
+typedef struct
+{
+    uint32 addr;
+    uint8 value;
+    RegSimRead onRead;
+    RegSimWrite onWrite;
+} SimReg;
+
+uint32 RegSim_Loads;
+uint32 RegSim_Stores;
+
+static SimReg regs[REGSIM_MAX];
+static int count;
+
+/* Register at addr, a new one reading 0 if it was never touched */
+static SimReg *Find(uint32 addr)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (regs[i].addr == addr) return &regs[i];
+    }
+    if (count == REGSIM_MAX)
+    {
+        printf("regsim: more than %d registers\n", REGSIM_MAX);
+        exit(2);
+    }
+    memset(&regs[count], 0, sizeof(regs[count]));
+    regs[count].addr = addr;
+    return &regs[count++];
+}
+
+void RegSim_Reset(void)
+{
+    count = 0;
+    RegSim_Loads = 0;
+    RegSim_Stores = 0;
+}
+void RegSim_Hook(uint32 addr, RegSimRead onRead, RegSimWrite onWrite)
+{
+    SimReg *r = Find(addr);
+
+    r->onRead = onRead;
+    r->onWrite = onWrite;
+}
+uint8 RegSim_Peek(uint32 addr)
+{
+    return Find(addr)->value;
+}
+void RegSim_Poke(uint32 addr, uint8 value)
+{
+    Find(addr)->value = value;
+}
+void RegSim_PokeField(uint32 addr, uint8 mask, uint8 bits)
+{
+    SimReg *r = Find(addr);
+
+    r->value = (uint8)((r->value & (uint8)~mask) | (bits & mask));
+}
+
+/* reg.h back end */
+uint8 RegSim_Read8(uint32 addr)
+{
+    SimReg *r = Find(addr);
+
+    RegSim_Loads++;
+    return r->onRead ? r->onRead(addr, r->value) : r->value;
+}
+void RegSim_Write8(uint32 addr, uint8 value)
+{
+    SimReg *r = Find(addr);
+
+    RegSim_Stores++;
+    r->value = value;
+    if (r->onWrite) r->onWrite(addr, value);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,40 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Host register file for Common/reg.h
+ * Holds every register a driver touches, counts its loads and stores
+ * and lets a model answer reads and follow writes
+ *
+ * ========================================
+*/
+#ifndef REGSIM_H
+#define REGSIM_H
+
+#include "project.h"
+
+/* Registers at most, taken on first access */
+#define REGSIM_MAX  64
+
+/* Model hooks: the value a read returns given the stored one, and what
+ * a write does besides storing */
+typedef uint8 (*RegSimRead)(uint32 addr, uint8 value);
+typedef void (*RegSimWrite)(uint32 addr, uint8 value);
+
+extern uint32 RegSim_Loads;
+extern uint32 RegSim_Stores;
+
+void RegSim_Reset(void);
+void RegSim_Hook(uint32 addr, RegSimRead onRead, RegSimWrite onWrite);
+/* Model side access, neither counted nor hooked */
+uint8 RegSim_Peek(uint32 addr);
+void RegSim_Poke(uint32 addr, uint8 value);
+void RegSim_PokeField(uint32 addr, uint8 mask, uint8 bits);
+
+#endif /* REGSIM_H */
+
+/* [] END OF FILE */
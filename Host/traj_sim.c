@@ -0,0 +1,127 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * Host simulation of the servo trajectory generator
+ * Runs trapezoid and S-curve moves through Traj_Step, checks that each
+ * lands on the target at rest within the limits, plots position against
+ * time and times one step. "traj_sim csv" prints the samples instead.
+ * Build: gcc -O2 -I. -I../QuangvPSoC5Servo.cydsn traj_sim.c ../QuangvPSoC5Servo.cydsn/trajectory.c -o traj_sim
+ * 
+ * ========================================
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "project.h"
+#include "trajectory.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define CYCLES() __rdtsc()
+#else
+    #define CYCLES() 0ull
+#endif
+
+/* Limits used on the rig: 4000 counts/s, 20000 counts/s^2, 200000 counts/s^3 */
+#define VMAX    TRAJ_VEL(4000)
+#define AMAX    TRAJ_ACC(20000)
+#define JMAX    TRAJ_JERK(200000)
+
+#define PLOT_W  64
+#define PLOT_H  16
+#define MAX_TICKS 1000
+
+/* CyLib stand-ins, the generator only needs the critical section */
+uint8 CyEnterCriticalSection(void) { return 0; }
+void CyExitCriticalSection(uint8 savedIntrStatus) { (void) savedIntrStatus; }
+
+static uint16 trace[MAX_TICKS];
+
+/* Position against time as text, one column per tick group */
+static void Plot(const uint16 *p, int n, uint16 lo, uint16 hi)
+{
+    char rows[PLOT_H][PLOT_W + 1];
+    int x, y, cols = n < PLOT_W ? n : PLOT_W;
+
+    memset(rows, ' ', sizeof(rows));
+    for (x = 0; x < cols; x++)
+    {
+        int i = x * (n - 1) / (cols > 1 ? cols - 1 : 1);
+        y = hi == lo ? 0 : (int)(((long)(p[i] - lo) * (PLOT_H - 1) + (hi - lo) / 2) / (hi - lo));
+        rows[PLOT_H - 1 - y][x] = '*';
+    }
+    for (y = 0; y < PLOT_H; y++)
+    {
+        rows[y][cols] = '\0';
+        printf("  %4ld |%s\n", lo + ((long)(hi - lo) * (PLOT_H - 1 - y) + (PLOT_H - 1) / 2) / (PLOT_H - 1), rows[y]);
+    }
+    printf("       +%.*s %d ticks (%d ms)\n", cols, "----------------------------------------------------------------", n, n * 1000 / TRAJ_TICK_HZ);
+}
+/* Run one move, return the number of failed checks */
+static int Run(uint8 profile, uint16 from, uint16 to, int plot, int csv)
+{
+    Traj t;
+    int n = 0, fail = 0;
+    int32 vPeak = 0, aPeak = 0, lastVel = 0;
+    uint16 planned;
+
+    Traj_Init(&t, from, profile, VMAX, AMAX, JMAX);
+    planned = Traj_Move(&t, to);
+    while (!Traj_Done(&t) && n < MAX_TICKS)
+    {
+        trace[n] = Traj_Step(&t);
+        if (csv) printf("%d,%s,%d,%u,%ld,%ld\n", n, profile ? "scurve" : "trapezoid", n * 1000 / TRAJ_TICK_HZ,
+                        trace[n], (long)t.vel, (long)t.acc);
+        if (abs(t.vel) > vPeak) vPeak = abs(t.vel);
+        if (abs(t.vel - lastVel) > aPeak) aPeak = abs(t.vel - lastVel);
+        lastVel = t.vel;
+        n++;
+    }
+    if (csv) return 0;
+    printf("%-9s %4u -> %4u: %3d ticks (planned %u), end %4u, vpeak %5.1f%%, apeak %5.1f%%\n",
+           profile ? "S-curve" : "trapezoid", from, to, n, planned, Traj_Position(&t),
+           100.0 * vPeak / VMAX, 100.0 * aPeak / AMAX);
+    if (Traj_Position(&t) != to || t.vel != 0) { printf("  FAIL: not at rest on the target\n"); fail++; }
+    if (n != planned) { printf("  FAIL: tick count\n"); fail++; }
+    if (vPeak > VMAX || aPeak > AMAX) { printf("  FAIL: limits\n"); fail++; }
+    if (n >= 2 && (abs((int)trace[n - 2] - to) > 3 + abs((int)(VMAX >> TRAJ_Q)))) { printf("  FAIL: jump at the end\n"); fail++; }
+    if (plot) Plot(trace, n, from < to ? from : to, from < to ? to : from);
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint16 moves[][2] = { {1500, 2400}, {2400, 500}, {500, 1000}, {1500, 1520}, {1500, 1501}, {1000, 1000} };
+    int csv = argc > 1 && strcmp(argv[1], "csv") == 0;
+    int fail = 0;
+    unsigned i, p, k;
+    unsigned long long c0, c1, best = ~0ull;
+    Traj t;
+
+    if (csv) printf("tick,profile,ms,compare,vel_q16,acc_q16\n");
+    for (p = TRAJ_TRAPEZOID; p <= TRAJ_SCURVE; p++)
+        for (i = 0; i < sizeof(moves) / sizeof(moves[0]); i++)
+            fail += Run((uint8)p, moves[i][0], moves[i][1], !csv && i == 1, csv);
+    if (csv) return 0;
+
+    /* Cost of one step in the middle of a move */
+    for (k = 0; k < 1000; k++)
+    {
+        Traj_Init(&t, 500, TRAJ_SCURVE, VMAX, AMAX, JMAX);
+        Traj_Move(&t, 2400);
+        c0 = CYCLES();
+        Traj_Step(&t);
+        c1 = CYCLES();
+        if (c1 - c0 < best) best = c1 - c0;
+    }
+    printf("Traj_Step: %llu host cycles (best of 1000)\n", best);
+    printf(fail ? "%d checks failed\n" : "all passed\n", fail);
+    return fail != 0;
+}
+
+/* [] END OF FILE */
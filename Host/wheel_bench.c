@@ -0,0 +1,184 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * Host benchmark of the timer wheel in Common/timerwheel.c
+ * Checks that every timer fires on its tick, periodic ones on every
+ * period and stopped ones never, then times start, stop and the tick
+ * with more and more timers armed, next to a sorted list.
+ * Build: gcc -O2 -I. -I../Common wheel_bench.c ../Common/timerwheel.c -o wheel_bench
+ *
+ * ========================================
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "project.h"
+#include "timerwheel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define CYCLES() __rdtsc()
+#else
+    #define CYCLES() 0ull
+#endif
+
+#define MAX_TIMERS  1024
+#define SPAN        10000u      // deadlines up to 10 s of 1 ms ticks
+#define BENCH_TICKS 20000u
+
+/* CyLib stand-ins */
+uint8 CyEnterCriticalSection(void) { return 0; }
+void CyExitCriticalSection(uint8 savedIntrStatus) { (void) savedIntrStatus; }
+
+static Timer timers[MAX_TIMERS + 1];
+static uint32 due[MAX_TIMERS];
+static uint32 now;
+static int errors;
+static unsigned long fires;
+
+static void Expire(Timer *t)
+{
+    int i = (int)(t - timers);
+
+    if (now != due[i])
+    {
+        if (errors++ < 5) printf("timer %d fired at %lu, due %lu\n", i, (unsigned long)now,
+                                 (unsigned long)due[i]);
+    }
+    due[i] = t->period ? now + t->period : 0xFFFFFFFFu;
+    fires++;
+}
+static void Count(Timer *t)
+{
+    (void) t;
+    fires++;
+}
+
+/* Random deadlines and periods over several wheel levels, run them for
+ * long enough that every level cascades */
+static int Check(void)
+{
+    int i;
+    uint32 ticks, start = 0xFFFFF000u;   // cross the 32 bit wrap as well
+
+    errors = 0;
+    fires = 0;
+    now = start;
+    TimerWheel_Init(now);
+    for (i = 0; i < MAX_TIMERS; i++)
+    {
+        timers[i].expire = Expire;
+        timers[i].pprev = NULL;
+        ticks = i % 7 == 0 ? (uint32)rand() % 300000u : (uint32)rand() % SPAN;
+        TimerWheel_Start(&timers[i], ticks, i % 3 == 0 ? 1u + (uint32)rand() % 500u : 0u);
+        due[i] = now + ticks;
+    }
+    /* Every fifth one is stopped again */
+    for (i = 0; i < MAX_TIMERS; i += 5)
+    {
+        TimerWheel_Stop(&timers[i]);
+        due[i] = 0xFFFFFFFFu;
+    }
+    for (; now != start + 400000u; now++) TimerWheel_Run(now);
+    for (i = 0; i < MAX_TIMERS; i++)
+    {
+        if (due[i] != 0xFFFFFFFFu && (int32)(due[i] - now) < 0)
+        {
+            if (errors++ < 5) printf("timer %d never fired, due %lu\n", i, (unsigned long)due[i]);
+        }
+        TimerWheel_Stop(&timers[i]);
+    }
+    printf("check      %lu expiries, %d errors\n", fires, errors);
+    return errors != 0;
+}
+
+/* Sorted singly linked list, what a simple deadline queue would do */
+static Timer *sorted;
+static void List_Start(Timer *t, uint32 ticks)
+{
+    Timer **p = &sorted;
+
+    t->expires = now + ticks;
+    while (*p && (int32)((*p)->expires - t->expires) <= 0) p = &(*p)->next;
+    t->next = *p;
+    *p = t;
+}
+static void List_Stop(Timer *t)
+{
+    Timer **p = &sorted;
+
+    while (*p && *p != t) p = &(*p)->next;
+    if (*p) *p = t->next;
+}
+
+static void Bench(int n)
+{
+    unsigned long long c, start = 0, stop = 0, tick = 0, lstart = 0, lstop = 0;
+    int i, k;
+
+    /* Wheel: n armed timers, then start and stop one more many times */
+    now = 0;
+    TimerWheel_Init(now);
+    for (i = 0; i < n; i++)
+    {
+        timers[i].expire = Count;
+        timers[i].pprev = NULL;
+        TimerWheel_Start(&timers[i], 1u + (uint32)rand() % SPAN, SPAN);
+    }
+    for (k = 0; k < 1000; k++)
+    {
+        Timer *t = &timers[n];
+        uint32 ticks = 1u + (uint32)rand() % SPAN;
+
+        t->expire = Count;
+        c = CYCLES();
+        TimerWheel_Start(t, ticks, 0u);
+        start += CYCLES() - c;
+        c = CYCLES();
+        TimerWheel_Stop(t);
+        stop += CYCLES() - c;
+    }
+    /* Ticks, with the periodic timers expiring and cascading */
+    c = CYCLES();
+    for (now = 0; now < BENCH_TICKS; now++) TimerWheel_Run(now);
+    tick = CYCLES() - c;
+    for (i = 0; i < n; i++) TimerWheel_Stop(&timers[i]);
+
+    /* Sorted list with the same number of timers */
+    sorted = NULL;
+    now = 0;
+    for (i = 0; i < n; i++) List_Start(&timers[i], 1u + (uint32)rand() % SPAN);
+    for (k = 0; k < 1000; k++)
+    {
+        Timer *t = &timers[n];
+        uint32 ticks = 1u + (uint32)rand() % SPAN;
+
+        c = CYCLES();
+        List_Start(t, ticks);
+        lstart += CYCLES() - c;
+        c = CYCLES();
+        List_Stop(t);
+        lstop += CYCLES() - c;
+    }
+    printf("%5d %11llu %10llu %10llu %13llu %11llu\n", n, start / 1000, stop / 1000,
+           tick / BENCH_TICKS, lstart / 1000, lstop / 1000);
+}
+
+int main(void)
+{
+    int n, err;
+
+    srand(1);
+    err = Check();
+    printf("\n            wheel cycles                 sorted list cycles\n");
+    printf("armed       start       stop       tick         start        stop\n");
+    for (n = 16; n <= MAX_TIMERS; n *= 2) Bench(n);
+    printf(err ? "FAIL\n" : "PASS\n");
+    return err;
+}
+
+/* [] END OF FILE */
@@ -16,31 +16,191 @@
 
 #include "project.h"
 #include "stdio.h"
+#include "systime.h"
+#include "coop.h"
+#include "idle.h"
+#include "clkscale.h"
+#include "cycles.h"
+#include "bitpin.h"
+
+/* Half a blink, and how often the button and the UART are looked at */
+#define BLINK_US        500000u
+#define BUTTON_POLL_US  10000u
+#define CONSOLE_POLL_US 1000u
+/* How often the bus clock follows the load */
+#define CLOCKS_US       1000000u
+/* Toggles per way in the toggle benchmark */
+#define TOGGLES         1000u
+/* Deep sleep window per clock restore in the deep sleep benchmark */
+#define DEEP_US         2000000u
+
+static uint8 count = 0;
+/* Window of the deep sleep benchmark, 0 when it is not running */
+static uint8 deepStep = 0;
+
+static void Blink(void);
+static void Console(void);
+static void Clocks(void);
+static void ToggleBench(void);
+static void DeepBench(void);
+
+BITPIN_CHECK(LED1);
+BITPIN_CHECK(Button);
+
+/* name, task */
+static CoopTask Tasks[] =
+{
+    { "Blink", Blink },
+    { "Console", Console },
+    { "Clocks", Clocks },
+};
+#define TASK_COUNT (sizeof(Tasks)/sizeof(Tasks[0]))
+
+/* Divided clocks that keep their frequency when the bus clock changes */
+static ScaledClock Clocks_Scaled[] =
+{
+    { UART_IntClock_SetDividerRegister, UART_IntClock_GetDividerRegister },
+};
 
 int main(void)
 {
     CyGlobalIntEnable; /* Enable global interrupts. */
 
     /* Place your initialization/startup code here (e.g. MyInst_Start()) */
-    uint8 count = 0;
     char str[20] = {"Quang Vu\r\n"};
     
     UART_Start();
+    SysTime_Start();
+    Cycles_Start();
+    ClkScale_Init(Clocks_Scaled, sizeof(Clocks_Scaled)/sizeof(Clocks_Scaled[0]));
     /* Transmit name terminated with CR/LF (string) on the beginning of the program */
     UART_PutString(str);
+    Coop_Init(Tasks, TASK_COUNT);
+    /* Stop the CPU between tasks, not the clocks: the UART has to keep
+     * receiving. Only the 'D' benchmark stops them for a while. */
+    Idle_Start(0u, 0u);
     for(;;)
     {
-        if (!Button_Read()) {
-            LED1_Write(count++ % 2);
-            CyDelay(500);
+        if (Coop_Run() == 0u) Idle_Run();
+    }
+}
+/* Tasks */
+static void Blink(void)
+{
+    if (!BitPin_Read(Button)) {
+        BitPin_Write(LED1, count++ % 2);
+        Coop_Sleep(BLINK_US);
+    }
+    else {
+        BitPin_Write(LED1, 0); /* Turn off LED when the button is released */
+        Coop_Sleep(BUTTON_POLL_US);
+    }
+}
+static void Console(void)
+{
+    uint8 ch;
+    
+    if (deepStep) { /* The UART is deaf in deep sleep, nothing to read */
+        DeepBench();
+        return;
+    }
+    ch = UART_GetChar();
+    if (ch) { /* On UART read */
+        char buffer[24];
+        sprintf(buffer, "%d ", count/2); /* Save int to string buffer, divide by 2 for number of blinks */
+        UART_PutString(buffer); /* Print to screen */
+        if (ch == 'R' || ch == 'r') { /* Task latency, idle share and sleep */
+            Coop_Report(UART_PutString);
+            Idle_Report(UART_PutString);
+            sprintf(buffer, "%lu MHz\r\n", ClkScale_Hz() / 1000000u);
+            UART_PutString(buffer);
         }
-        LED1_Write(0); /* Turn off LED when the button is released */
-        if (UART_GetChar()) { /* On UART read */
-            char buffer[5];
-            sprintf(buffer, "%d ", count/2); /* Save int to string buffer, divide by 2 for number of blinks */
-            UART_PutString(buffer); /* Print to screen */
+        if (ch == 'T' || ch == 't') ToggleBench();
+        if (ch == 'D' || ch == 'd') { /* Deep sleep clock restore, PmClk against generated */
+            DeepBench();
+            return;
         }
     }
+    Coop_Sleep(CONSOLE_POLL_US);
+}
+static void Clocks(void)
+{
+    /* Awake share since the last run, at the clock it ran on */
+    static uint32 lastSlept = 0, lastRun = 0;
+    uint32 slept = Idle_SleptUs() - lastSlept;
+    uint32 total = (SysTime_Us() - lastRun) / 1000u;
+    
+    lastSlept += slept;
+    lastRun += total * 1000u;
+    if (total > 0u && slept / total <= 1000u) ClkScale_Govern((uint16)(1000u - slept / total));
+    Coop_Sleep(CLOCKS_US);
+}
+/* Cycles per LED toggle through the generated API and through the
+ * bit-band alias, interrupts held off, and the toggle rate each gives */
+static void ToggleBench(void)
+{
+    char buffer[64];
+    uint32 start, cycles[3];
+    uint16 i;
+    uint8 intState;
+    
+    Cycles_Enable();
+    intState = CyEnterCriticalSection();
+    start = Cycles_Now();
+    for (i = 0u; i < TOGGLES; i++) LED1_Write(!LED1_Read());
+    cycles[0] = Cycles_Now() - start;
+    start = Cycles_Now();
+    for (i = 0u; i < TOGGLES; i++) BitPin_Write(LED1, i & 1u);
+    cycles[1] = Cycles_Now() - start;
+    start = Cycles_Now();
+    for (i = 0u; i < TOGGLES; i++) BitPin_Toggle(LED1);
+    cycles[2] = Cycles_Now() - start;
+    CyExitCriticalSection(intState);
+    
+    for (i = 0u; i < 3u; i++)
+    {
+        /* Two toggles make one period of the pin */
+        sprintf(buffer, "%-7s %4lu.%lu cycles %6lu kHz\r\n", i == 0u ? "API" : i == 1u ? "Write" : "Toggle",
+                cycles[i] / TOGGLES, cycles[i] % TOGGLES / (TOGGLES / 10u),
+                ClkScale_Hz() / 2000u * TOGGLES / cycles[i]);
+        UART_PutString(buffer);
+    }
+}
+/* Deep sleep between the tasks for DEEP_US with each clock restore, one
+ * window per console run, then print how long each took from the wakeup
+ * to the first task. The console is the only task that needs the clocks
+ * running and it waits the windows out. */
+static void DeepBench(void)
+{
+    static IdleStat fast;
+    char buffer[64];
+    
+    switch (deepStep++)
+    {
+        case 0u:
+            /* Let the echo out before the UART clock stops, the last byte
+             * takes about 1 ms at 9600 baud */
+            while (UART_GetTxBufferSize()) {}
+            CyDelay(2u);
+            Idle_Start(IDLE_DEEP_FAST, 0u);
+            break;
+        case 1u:
+            fast = Idle_Stat;
+            Idle_Start(IDLE_DEEP_CYPM, 0u);
+            break;
+        default:
+            sprintf(buffer, "PmClk %4lu deep, restore %5lu/%5lu cycles\r\n",
+                    fast.deepSleeps, fast.restore.last, fast.restore.max);
+            UART_PutString(buffer);
+            sprintf(buffer, "CyPm  %4lu deep, restore %5lu/%5lu cycles\r\n",
+                    Idle_Stat.deepSleeps, Idle_Stat.restore.last, Idle_Stat.restore.max);
+            UART_PutString(buffer);
+            Idle_Start(0u, 0u);
+            deepStep = 0u;
+            Coop_Sleep(CONSOLE_POLL_US);
+            return;
+    }
+    Coop_Sleep(DEEP_US);
 }
 
 /* [] END OF FILE */
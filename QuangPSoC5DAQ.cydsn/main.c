@@ -17,18 +17,46 @@
 #include <project.h>
 #include "stdio.h"
 #include "stdlib.h"
+#include "systime.h"
+#include "ratesched.h"
+#include "coop.h"
+#include "idle.h"
+#include "acq.h"
+#include "adcsensor.h"
 
 /* Project Defines */
-#define FALSE  0
-#define TRUE   1
-#define TRANSMIT_BUFFER_SIZE 40
-#define THRESHOLD 5000
+/* The ADC converts at 10 ksps, one line every 0.5 s */
+#define ADC_PERIOD_US   100u
+#define EMIT_PERIOD_US  500000u
+/* Commands are single characters, the UART FIFO holds 4 */
+#define CONSOLE_POLL_US 1000u
 
-/* ISR Handler */
-CY_ISR_PROTO(ADC_ISR_Handler);
+/* name, driver, argument, period, fractional bits, decimals, latest */
+static Sensor Sensors[] =
+{
+    { "ADC", &AdcSensor_mV, 0, ADC_PERIOD_US, ADC_SENSOR_FRAC, 0, 1 },
+    { "Temperature", &AdcSensor_Temp, 1, ADC_PERIOD_US, ADC_SENSOR_FRAC, 1 },
+};
+#define SENSOR_COUNT (sizeof(Sensors)/sizeof(Sensors[0]))
+
+/* name, job, period, phase */
+static RateJob Jobs[] =
+{
+    { "Acq", Acq_Run, ADC_PERIOD_US, 0u },
+    { "Emit", Acq_Emit, EMIT_PERIOD_US, 0u },
+};
+#define JOB_COUNT (sizeof(Jobs)/sizeof(Jobs[0]))
 
-/* Flag for interrupt */
-static volatile CYBIT ADC_flag = FALSE;
+static void Console(void);
+static void Rates(void);
+
+/* name, task */
+static CoopTask Tasks[] =
+{
+    { "Console", Console },
+    { "Rates", Rates },
+};
+#define TASK_COUNT (sizeof(Tasks)/sizeof(Tasks[0]))
 
 /*******************************************************************************
 * Function Name: main
@@ -37,12 +65,14 @@ static volatile CYBIT ADC_flag = FALSE;
 * Summary:
 *  main() performs following functions:
 *  1: Starts the ADC and UART components.
-*  2: Checks for ADC end of conversion.  Stores latest result in output
-*     if conversion complete.
+*  2: Runs the acquisition core, which sends the last ADC conversion in mV
+*     and the mean temperature of all of them every 0.5 s.
 *  3: Checks for UART input.
 *     On 'C' or 'c' received: transmits the last sample via the UART.
 *     On 'S' or 's' received: continuously transmits samples as they are completed.
 *     On 'X' or 'x' received: stops continuously transmitting samples.
+*     On 'R' or 'r' received: transmits the job, sensor, task and sleep statistics.
+*  The console and the jobs are cooperative tasks, see Tasks.
 *
 * Parameters:
 *  None.
@@ -54,116 +84,59 @@ static volatile CYBIT ADC_flag = FALSE;
 int main()
 {
     CyGlobalIntEnable;
-    /* Variable to store ADC result */
-    uint32 Output;
-    /* Variable to store UART received character */
-    uint8 Ch;
-    /* Flags used to store transmit data commands */
-    uint8 ContinuouslySendData;
-    uint8 SendSingleByte;
-    /* values for the down-sampling */
-    uint32 sum = 0;
-    uint32 cnt = 0;
-    /* Transmit Buffer */
-    char TransmitBuffer[TRANSMIT_BUFFER_SIZE];
     
     /* Start the components */
-    ADC_DelSig_1_Start();
+    AdcSensor_Start();
     UART_1_Start();
-    
-    /* Initialize Variables */
-    ContinuouslySendData = FALSE;
-    SendSingleByte = FALSE;
-    
-    /* Start the ADC conversion */
-    ADC_DelSig_1_StartConvert();
+    SysTime_Start();
     
     /* Send message to verify COM port is connected properly */
     UART_1_PutString("COM Port Open");
     
-    /* Start the ISR */
-    ADC_DelSig_1_IRQ_StartEx(ADC_ISR_Handler);
+    /* First read of the sensor and first release of every job */
+    Acq_Init(Sensors, SENSOR_COUNT, UART_1_PutString);
+    RateSched_Init(Jobs, JOB_COUNT);
+    Coop_Init(Tasks, TASK_COUNT);
+    /* The CPU waits for interrupts between tasks, the ADC keeps converting */
+    Idle_Start(0u, 0u);
     
     for(;;)
     {        
-        /* Non-blocking call to get the latest data recieved  */
-        Ch = UART_1_GetChar();
-        
-        /* Set flags based on UART command */
-        switch(Ch)
-        {
-            case 0:
-                /* No new data was recieved */
-                break;
-            case 'C':
-            case 'c':
-                SendSingleByte = TRUE;
-                break;
-            case 'S':
-            case 's':
-                ContinuouslySendData = TRUE;
-                break;
-            case 'X':
-            case 'x':
-                ContinuouslySendData = FALSE;
-                break;
-            default:
-                /* Place error handling code here */
-                break;    
-        }
-        
-        /* Check to see if an ADC conversion has completed */
-        if(ADC_DelSig_1_IsEndConversion(ADC_DelSig_1_RETURN_STATUS))
-        {
-            /* Use the GetResult16 API to get an 8 bit unsigned result in
-             * single ended mode.  The API CountsTo_mVolts is then used
-             * to convert the ADC counts into mV before transmitting via
-             * the UART.  See the datasheet API description for more
-             * details */
-            Output = ADC_DelSig_1_CountsTo_mVolts(ADC_DelSig_1_GetResult16());
-            
-            /* Send data based on last UART command */
-            if(SendSingleByte || ContinuouslySendData)
-            {
-                /* Flag set => reached 0.5s threshold */
-                if (ADC_flag) 
-                {
-                    /* Format ADC result for transmition */
-                    /* The conversion of ADC value to temperature for this sensor is 10mV = 1 degree Celcius */
-                    sprintf(TransmitBuffer, "{ ADC :%lu , Temperature :%.1f }\r\n", Output,(float) sum/cnt/10);
-                    /* Send out the data */
-                    UART_1_PutString(TransmitBuffer);
-                    /* Reset flags and values */
-                    ADC_flag = FALSE;
-                    sum = 0;
-                    cnt = 0;
-                } //output data 
-                else 
-                {
-                    sum+=Output;
-                    cnt++;
-                } //gather data
-                /* Reset the send once flag */
-                SendSingleByte = FALSE;
-            }
-        }
+        if (Coop_Run() == 0u) Idle_Run();
     }
 }
-/* ISR routines */
-CY_ISR(ADC_ISR_Handler)
+/* Tasks */
+static void Console(void)
 {
-    static uint32 clk = 0;
-    /* Threshold = defined sample per seconds / sample rate 
-     * The clock only runs when the flag is not set (calculation for output is finished 
-     * This can result in data being captured but ignored completely 
-     * However, the integrity of the data will be preserved */
-    if (clk < THRESHOLD && !ADC_flag) clk++;
-    else 
+    /* Non-blocking call to get the latest data recieved  */
+    uint8 Ch = UART_1_GetChar();
+    
+    /* Set flags based on UART command */
+    switch(Ch)
     {
-        clk = 0;
-        ADC_flag = TRUE;
-    } //reset clock and set flags
-    /* The interupt is automatically reset in this case */
+        case 0:
+            /* No new data was recieved */
+            break;
+        case 'R':
+        case 'r':
+            /* Report runs, deadline misses and jitter of each job,
+             * then latency of each task and the idle share */
+            RateSched_Report(Jobs, JOB_COUNT, UART_1_PutString);
+            Acq_Report();
+            Coop_Report(UART_1_PutString);
+            Idle_Report(UART_1_PutString);
+            break;
+        default:
+            /* 'C', 'S' and 'X' are handled by the acquisition core */
+            Acq_Command(Ch);
+            break;    
+    }
+    Coop_Sleep(CONSOLE_POLL_US);
+}
+/* Run the jobs that are due, then sleep until the next release */
+static void Rates(void)
+{
+    Coop_SleepUntil(RateSched_Run(Jobs, JOB_COUNT));
 }
 
 /* [] END OF FILE */
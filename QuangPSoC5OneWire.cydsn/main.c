@@ -16,20 +16,71 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include "onewirelib.h"
+#include "systime.h"
+#include "ratesched.h"
+#include "coop.h"
+#include "idle.h"
+#include "usdelay.h"
+#include "acq.h"
+#include "adcsensor.h"
+#include "owsensor.h"
 
 /* Project Defines */
 #define FALSE  0
 #define TRUE   1
-#define TRANSMIT_BUFFER_SIZE 40
-#define THRESHOLD 5000
+#define TRANSMIT_BUFFER_SIZE 64
 #define DEBUG 0
+/* OneWire resolution in bits (9 to 12), 9 bits converts 8 times faster */
+#define OW_RESOLUTION 12
+/* Sensor periods in microseconds. The ADC converts at 10 ksps,
+ * a 12 bit OneWire conversion takes up to 750 ms. */
+#define ADC_PERIOD_US   100u
+#define OW_PERIOD_US    1000000u
+/* Output window, one line every 0.5 s */
+#define EMIT_PERIOD_US  500000u
+/* Commands are single characters, the UART FIFO holds 4 */
+#define CONSOLE_POLL_US 1000u
 
 /* ISR Handler */
 CY_ISR_PROTO(ADC_ISR_Handler);
 
-/* Flag for interrupt */
-static volatile CYBIT ADC_flag = FALSE;
-static volatile CYBIT handled = FALSE;
+/* The ADC and one sensor per OneWire device, set up in main */
+static Sensor Sensors[2 + OW_MAX_DEVICES] =
+{
+    /* name, driver, argument, period, fractional bits, decimals, latest */
+    { "ADC", &AdcSensor_mV, 0, ADC_PERIOD_US, ADC_SENSOR_FRAC, 0, 1 },
+    { "Temperature", &AdcSensor_Temp, 1, ADC_PERIOD_US, ADC_SENSOR_FRAC, 1 },
+};
+#define SENSOR_COUNT (sizeof(Sensors)/sizeof(Sensors[0]))
+
+/* name, job, period, phase */
+static RateJob Jobs[] =
+{
+    { "Acq", Acq_Run, ADC_PERIOD_US, 0u },
+    { "Emit", Acq_Emit, EMIT_PERIOD_US, 0u },
+};
+#define JOB_COUNT (sizeof(Jobs)/sizeof(Jobs[0]))
+
+static void Console(void);
+#if DEBUG
+static void Search(void);
+/* Transmit Buffer */
+static char TransmitBuffer[TRANSMIT_BUFFER_SIZE];
+#else
+static void Rates(void);
+#endif
+
+/* name, task */
+static CoopTask Tasks[] =
+{
+    { "Console", Console },
+#if DEBUG
+    { "Search", Search },
+#else
+    { "Rates", Rates },
+#endif
+};
+#define TASK_COUNT (sizeof(Tasks)/sizeof(Tasks[0]))
 
 /* Subprocesses declaration */
 float bintofloat(signed int x);
@@ -39,13 +90,15 @@ float bintofloat(signed int x);
 *
 * Summary:
 *  main() performs following functions:
-*  1: Starts the ADC and UART components.
-*  2: Checks for ADC end of conversion.  Stores latest result in output
-*     if conversion complete.
+*  1: Starts the ADC and UART components and searches the OneWire bus.
+*  2: Runs the acquisition core, which reads the ADC and every OneWire
+*     device at its own rate and sends the averages every 0.5 s.
 *  3: Checks for UART input.
 *     On 'C' or 'c' received: transmits the last sample via the UART.
 *     On 'S' or 's' received: continuously transmits samples as they are completed.
 *     On 'X' or 'x' received: stops continuously transmitting samples.
+*     On 'R' or 'r' received: transmits the job, sensor, task and sleep statistics.
+*  The console and the jobs are cooperative tasks, see Tasks.
 *
 * Parameters:
 *  None.
@@ -57,37 +110,13 @@ float bintofloat(signed int x);
 int main()
 {
     CyGlobalIntEnable;
-    /* Variable to store ADC result */
-    uint32 Output;
-    /* Variable to store UART received character */
-    uint8 Ch;
-    /* Flags used to store transmit data commands */
-    uint8 ContinuouslySendData;
-    uint8 SendSingleByte;
-    /* values for the down-sampling */
-    uint32 sum = 0;
-    uint32 cnt = 0;
-    /* Variable to store the OneWire return byte */
-    unsigned char OWByte[9] = {0,};
-    /* Variable to store the OneWire temperature result */
-    float OWOutput = 0;
-    /* OneWire flag for the delay between commands */
-    int OWFlag = 0;
-    /* 64-bit slave address */
-    unsigned char Addr[8]={0,};
-    /* Transmit Buffer */
-    char TransmitBuffer[TRANSMIT_BUFFER_SIZE];
     
     /* Start the components */
-    ADC_DelSig_1_Start();
+    AdcSensor_Start();
     UART_1_Start();
-    
-    /* Initialize Variables */
-    ContinuouslySendData = FALSE;
-    SendSingleByte = FALSE;
-    
-    /* Start the ADC conversion */
-    ADC_DelSig_1_StartConvert();
+    SysTime_Start();
+    /* The 1-Wire slots wait on the cycle counter */
+    UsDelay_Start();
     
     /* Send message to verify COM port is connected properly */
     UART_1_PutString("COM Port Open\r\n");
@@ -96,141 +125,97 @@ int main()
     ADC_DelSig_1_IRQ_StartEx(ADC_ISR_Handler);
     
     /* Set Speed */
-    SetSpeed();
+    SetSpeed(&OWStandard);
     /* Start the OneWire Pin high */
     OneWireD_Write(TRUE);
+    /* Search the bus unless the ROM table survived the reset. OWEnumerate
+     * holds interrupts off during each search pass and overdrive probe,
+     * so no slot is stretched and SysTick and the UART run in between. */
+    if (!OWTableValid()) OWEnumerate();
+    /* Same resolution for every device. Only the scratchpad is written,
+     * a power-up loads the EEPROM value again, so it is set on every
+     * start. A slot stretched by an interrupt would corrupt the config
+     * byte until then. */
+    CyGlobalIntDisable;
+    OWSetResolution(OW_ALL, OW_RESOLUTION);
+    CyGlobalIntEnable;
+    OWSensor_Setup(&Sensors[2], OW_MAX_DEVICES, OW_PERIOD_US, OW_RESOLUTION);
+#if DEBUG
+    /* Report the byte time of each speed */
+    sprintf(TransmitBuffer, "Standard %lu ns/byte, Overdrive %lu ns/byte\r\n",
+            OWByteTimeNs(&OWStandard), OWByteTimeNs(&OWOverdrive));
+    UART_1_PutString(TransmitBuffer);
+#endif
+    /* First read of every sensor and first release of every job */
+    Acq_Init(Sensors, SENSOR_COUNT, UART_1_PutString);
+    RateSched_Init(Jobs, JOB_COUNT);
+    Coop_Init(Tasks, TASK_COUNT);
+    /* The CPU waits for interrupts between tasks, the 10 kHz ADC runs on */
+    Idle_Start(0u, 0u);
     
     for(;;)
     {        
-        /* Non-blocking call to get the latest data recieved  */
-        Ch = UART_1_GetChar();
-        
-        /* Set flags based on UART command */
-        switch(Ch)
-        {
-            case 0:
-                /* No new data was recieved */
-                break;
-            case 'C':
-            case 'c':
-                SendSingleByte = TRUE;
-                break;
-            case 'S':
-            case 's':
-                ContinuouslySendData = TRUE;
-                break;
-            case 'X':
-            case 'x':
-                ContinuouslySendData = FALSE;
-                break;
-            default:
-                /* Place error handling code here */
-                break;    
-        }
-#if DEBUG       
-        uint crc=0xff;
-        CYGlobalIntDisable;
-        if (OWTouchReset() == 0)
-        {
-            OWWriteByte(0x33);
-            CyDelay(1000);
-            for (int i =0;i<8;i++)
-            {
-               Addr[i] = OWReadByte();                
-            }        
-        }
-        CyGlobalIntEnable;
-        crc = OWCRC(Addr,7);
-        if (crc == Addr[7])
-            UART_1_PutString("True\r\n");
-        else
-            UART_1_PutString("False\r\n");
-#else
-        /* OneWire Communication - Start Conversion */
-        if (OWFlag == 0)
-        {
-            while(!handled) {}
-            CyGlobalIntDisable;
-            /* 0 means slave responded */
-            if (OWTouchReset() == 0)
-            {
-                /* send skip ROM command */
-                OWWriteByte(0xCC);
-                /* send convert T command */
-                OWWriteByte(0x44);
-                CyGlobalIntEnable;
-                handled = FALSE;
-                /* set flag to 1 to not go back until cleared */
-                OWFlag++;
-            }
-        }   //Start conversion 
-        else if (OWFlag == 3)
-        {
-            while(!handled) {}
-            CyGlobalIntDisable;
-            /* 0 means slave responded */
-            if (OWTouchReset() == 0)
-            {
-                /* Send skip ROM command */
-                OWWriteByte(0xCC);
-                /* Send read scratchpad command */
-                OWWriteByte(0xBE);
-                /* Read 9 bytes of data */
-                for (int i =0;i<9;i++)
-                {
-                    OWByte[i] = OWReadByte();                
-                }
-                CyGlobalIntEnable;
-                handled = FALSE;
-                /* Remove the first 4 MSB bits (not used) */
-                OWByte[1] = OWByte[1] & 0x0f;
-                /* Store the first 2 bytes into a variable (integer) */
-                int temp = (OWByte[1] << 8) | (OWByte[0] & 0xF0);
-                OWOutput = temp>>4;
-                if (OWByte[1] & 0x08) OWOutput-=128;
-                /* Reset the flag */
-                OWFlag = 0;
-            }
-        }   //Read the data
-#endif        
-        /* Check to see if an ADC conversion has completed */
-        if(ADC_DelSig_1_IsEndConversion(ADC_DelSig_1_RETURN_STATUS))
+        if (Coop_Run() == 0u) Idle_Run();
+    }
+}
+/* Tasks */
+static void Console(void)
+{
+    /* Non-blocking call to get the latest data recieved  */
+    uint8 Ch = UART_1_GetChar();
+    
+    /* Set flags based on UART command */
+    switch(Ch)
+    {
+        case 0:
+            /* No new data was recieved */
+            break;
+        case 'R':
+        case 'r':
+            /* Report runs, deadline misses and jitter of each job,
+             * then latency of each task and the idle share */
+            RateSched_Report(Jobs, JOB_COUNT, UART_1_PutString);
+            Acq_Report();
+            Coop_Report(UART_1_PutString);
+            Idle_Report(UART_1_PutString);
+            break;
+        case 'J':
+        case 'j':
+            /* Overrun of CyDelayUs and of the deadlines with the ADC
+             * interrupt running, blocks for a few tenths of a second */
+            UsDelay_Report(UART_1_PutString);
+            break;
+        default:
+            /* 'C', 'S' and 'X' are handled by the acquisition core */
+            Acq_Command(Ch);
+            break;    
+    }
+    Coop_Sleep(CONSOLE_POLL_US);
+}
+#if DEBUG
+/* Search the bus again and list every ROM found, once a second */
+static void Search(void)
+{
+    if (OWEnumerate() == 0)
+        UART_1_PutString("No device\r\n");
+    for (int dev = 0; dev < OWDevices.count; dev++)
+    {
+        for (int i = 0; i < OW_ROM_SIZE; i++)
         {
-            /* Use the GetResult16 API to get an 8 bit unsigned result in
-             * single ended mode.  The API CountsTo_mVolts is then used
-             * to convert the ADC counts into mV before transmitting via
-             * the UART.  See the datasheet API description for more
-             * details */
-            Output = ADC_DelSig_1_CountsTo_mVolts(ADC_DelSig_1_GetResult16());
-            
-            /* Send data based on last UART command */
-            if(SendSingleByte || ContinuouslySendData)
-            {
-                /* Flag set => reached 0.5s threshold */
-                if (ADC_flag) 
-                {
-                    if (OWFlag < 3) OWFlag++;                    
-                    /* Format ADC result for transmition */
-                    /* The conversion of ADC value to temperature for this sensor is 10mV = 1 degree Celcius */
-                    sprintf(TransmitBuffer, "{ ADC :%lu , Temperature :%.1f , OneWire :%.1f }\r\n", Output,(float) sum/cnt/10, OWOutput);
-                    /* Send out the data */
-                    UART_1_PutString(TransmitBuffer);
-                    /* Reset flags and values */
-                    ADC_flag = FALSE;
-                    sum = 0;
-                    cnt = 0;
-                } //output data 
-                else 
-                {
-                    sum+=Output;
-                    cnt++;
-                } //gather data
-                /* Reset the send once flag */
-                SendSingleByte = FALSE;
-            }
+            sprintf(TransmitBuffer, "%02X", OWDevices.rom[dev][OW_ROM_SIZE - 1 - i]);
+            UART_1_PutString(TransmitBuffer);
         }
+        UART_1_PutString(OWDevices.overdrive[dev] ? " OD\r\n" : "\r\n");
     }
+    Coop_Sleep(1000000u);
 }
+#else
+/* Run the jobs that are due, then sleep until the next release */
+static void Rates(void)
+{
+    Coop_SleepUntil(RateSched_Run(Jobs, JOB_COUNT));
+}
+#endif
 /* Subprocesses */
 float bintofloat(signed int x) 
 {
@@ -244,18 +229,8 @@ float bintofloat(signed int x)
 /* ISR routines */
 CY_ISR(ADC_ISR_Handler)
 {
-    static uint32 clk = 0;
-    /* Threshold = defined sample per seconds / sample rate 
-     * The clock only runs when the flag is not set (calculation for output is finished 
-     * This can result in data being captured but ignored completely 
-     * However, the integrity of the data will be preserved */
-    if (clk < THRESHOLD && !ADC_flag) clk++;
-    else 
-    {
-        clk = 0;
-        ADC_flag = TRUE;
-    } //reset clock and set flags
-    handled = TRUE;
+    /* The OneWire driver starts a bus operation right after this interrupt */
+    OWSensor_Ticks++;
     /* The interupt is automatically reset in this case */
 }
 
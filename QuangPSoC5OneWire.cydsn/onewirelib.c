@@ -12,107 +12,522 @@
  * ========================================
 */
 #include "onewirelib.h"
+#include "crc8.h"
+#include "usdelay.h"
+#include "bitpin.h"
+#include <stddef.h>
+
+/* Magic value marking a filled ROM table */
+#define OW_TABLE_MAGIC 0x4F57524Ful
+/* Bytes of the ROM table covered by its CRC */
+#define OW_TABLE_CRC_LEN (offsetof(OWRomTable, crc) - offsetof(OWRomTable, count))
+
+/* Delay in 1/4 us, follows the CyDelay clock setting */
+#define OW_CYCLES(q) (((uint32)(q) * cydelay_freq_mhz) >> 2)
+
+/* Slot delays in CPU cycles, computed once per block. The edges are
+ * placed on deadlines of the cycle counter counted from t, the start of
+ * the current slot, so the time spent on the pin and between calls does
+ * not add to the slot. */
+typedef struct
+{
+    uint32 a, b, c, d, e, f;
+    uint32 t;                   // start of the next slot
+    uint32 late;                // a slot starting later than this starts anew
+} OWSlots;
+
+/* The bus pin is driven through its bit-band alias */
+BITPIN_CHECK(OneWireD);
+
+/* ROM table, not cleared by the startup code */
+CY_NOINIT OWRomTable OWDevices;
+
+/* Search state shared between OWFirst and OWNext */
+static unsigned char ROM_NO[OW_ROM_SIZE];
+static int LastDiscrepancy;
+static int LastDeviceFlag;
+
+/* Timing profiles in 1/4 us, recommended values of Maxim AN126 */
+const OWTiming OWStandard =
+{
+    24, 256, 240, 40, 36, 220, 0, 1920, 280, 1640
+};
+const OWTiming OWOverdrive =
+{
+    4, 30, 30, 10, 4, 28, 10, 280, 34, 160
+};
+/* Active profile */
+const OWTiming *OWSpeed = &OWStandard;
 
 /* Subprocesses */
-void SetSpeed()
-{
-    A = 6;
-    B = 64;
-    C = 60;
-    D = 10;
-    E = 9;
-    F = 55;
-    G = 0;
-    H = 480;
-    I = 70;
-    J = 410;
+/* Select the timing profile, OWStandard or OWOverdrive. This only changes
+ * the master, the slaves are switched by the overdrive ROM commands. */
+void SetSpeed(const OWTiming *speed)
+{
+    OWSpeed = speed;
+}
+/* Worst case time to transfer one byte with a profile, in ns */
+unsigned long OWByteTimeNs(const OWTiming *t)
+{
+    unsigned long slot = (unsigned long)(t->a + t->b);
+
+    if ((unsigned long)(t->c + t->d) > slot) slot = (unsigned long)(t->c + t->d);
+    if ((unsigned long)(t->a + t->e + t->f) > slot) slot = (unsigned long)(t->a + t->e + t->f);
+    /* 8 slots of 1/4 us */
+    return slot * 8 * 250;
 }
 /* Generate a 1-Wire reset, return 1 if no presence detect was found,
  * return 0 otherwise. */
 int OWTouchReset(void)
 {
     int result;
-    CyDelay(G);
-    OneWireD_Write(0); //Drives DQ Low
-    CyDelayUs(H);
-    OneWireD_Write(1); // Releases the bus
-    CyDelayUs(I);
-    result = OneWireD_Read();
-    CyDelayUs(J); // Complete the reset sequence recovery
+    uint32 t = UsDelay_Now();
+
+    t = UsDelay_Until(t + OW_CYCLES(OWSpeed->g));
+    BitPin_Write(OneWireD, 0); //Drives DQ Low
+    t = UsDelay_Until(t + OW_CYCLES(OWSpeed->h));
+    BitPin_Write(OneWireD, 1); // Releases the bus
+    t = UsDelay_Until(t + OW_CYCLES(OWSpeed->i));
+    result = BitPin_Read(OneWireD);
+    (void) UsDelay_Until(t + OW_CYCLES(OWSpeed->j)); // Complete the reset sequence recovery
     return result; // Return sample presence pulse result
 }
-/* Write 1-Wire data byte. */
-void OWWriteByte(int data)
+/* Load the slot delays of the active profile as CPU cycles, the first
+ * slot starts now */
+static void OWLoadSlots(OWSlots *cy)
+{
+    cy->a = OW_CYCLES(OWSpeed->a);
+    cy->b = OW_CYCLES(OWSpeed->b);
+    cy->c = OW_CYCLES(OWSpeed->c);
+    cy->d = OW_CYCLES(OWSpeed->d);
+    cy->e = OW_CYCLES(OWSpeed->e);
+    cy->f = OW_CYCLES(OWSpeed->f);
+    cy->late = UsDelay_Cycles(1u);
+    cy->t = UsDelay_Now();
+}
+/* Wait for the start of the next slot. A slot held up by more than a
+ * microsecond, by an interrupt or a caller between bits, starts when the
+ * CPU gets back, its recovery time is then longer and its low time
+ * stays whole. */
+static CY_INLINE void OWSlotStart(OWSlots *cy)
+{
+    uint32 now = UsDelay_Until(cy->t);
+
+    if (now - cy->t > cy->late) cy->t = now;
+}
+/* Write one bit with preloaded delays */
+static CY_INLINE void OWSlotWrite(OWSlots *cy, int bit)
+{
+    uint32 low = bit ? cy->a : cy->c;
+
+    OWSlotStart(cy);
+    BitPin_Write(OneWireD, 0); //Drives DQ Low
+    (void) UsDelay_Until(cy->t + low);
+    BitPin_Write(OneWireD, 1); // Releases the bus
+    cy->t += low + (bit ? cy->b : cy->d); // Complete the time slot and 10us recovery
+}
+/* Read one bit with preloaded delays */
+static CY_INLINE int OWSlotRead(OWSlots *cy)
+{
+    int result;
+
+    OWSlotStart(cy);
+    BitPin_Write(OneWireD, 0); //Drives DQ Low
+    (void) UsDelay_Until(cy->t + cy->a);
+    BitPin_Write(OneWireD, 1); // Releases the bus
+    (void) UsDelay_Until(cy->t + cy->a + cy->e);
+    result = BitPin_Read(OneWireD);
+    cy->t += cy->a + cy->e + cy->f; // Complete the time slot and 10us recovery
+    return result;
+}
+/* Wait out the recovery of the last slot */
+static CY_INLINE void OWSlotsEnd(const OWSlots *cy)
 {
+    (void) UsDelay_Until(cy->t);
+}
+/* Send a 1-Wire write bit. */
+void OWWriteBit(int bit)
+{
+    OWSlots cy;
+
+    OWLoadSlots(&cy);
+    OWSlotWrite(&cy, bit);
+    OWSlotsEnd(&cy);
+}
+/* Read a bit from the 1-Wire bus and return it. */
+int OWReadBit(void)
+{
+    OWSlots cy;
+    int result;
+
+    OWLoadSlots(&cy);
+    result = OWSlotRead(&cy);
+    OWSlotsEnd(&cy);
+    return result;
+}
+/* Write len bytes, LS-bit first. The delays are set up once per block. */
+void OWWriteBlock(const unsigned char *buf, int len)
+{
+    OWSlots cy;
+    int loop;
+    unsigned char data;
+
+    OWLoadSlots(&cy);
+    while (len-- > 0)
+    {
+        data = *buf++;
+        // Loop to write each bit in the byte, LS-bit first
+        for (loop = 0; loop < 8; loop++)
+        {
+            OWSlotWrite(&cy, data & 0x01);
+            // shift the data byte for the next bit
+            data >>= 1;
+        }
+    }
+    OWSlotsEnd(&cy);
+}
+/* Read len bytes into buf. With crcLen > 0 the stream is made of records
+ * of crcLen bytes, each one ending with its CRC. The CRC is computed as the
+ * bytes arrive and the read stops after the first record that fails.
+ * Return 0 if every record was correct (or crcLen is 0), 1 otherwise. */
+int OWReadBlock(unsigned char *buf, int len, int crcLen)
+{
+    OWSlots cy;
     int loop;
+    int n = 0;
+    unsigned char result;
+    unsigned char crc = 0;
 
-    // Loop to write each bit in the byte, LS-bit first
-    for (loop = 0; loop < 8; loop++)
+    OWLoadSlots(&cy);
+    while (len-- > 0)
     {
-        if (data & 0x01)
+        result = 0;
+        for (loop = 0; loop < 8; loop++)
         {
-            OneWireD_Write(0); //Drives DQ Low
-            CyDelayUs(A);
-            OneWireD_Write(1); // Releases the bus
-            CyDelayUs(B); // Complete the time slot and 10us recovery
-        }   // Write '1' bit
-        else
+            // shift the result to get it ready for the next bit
+            result >>= 1;
+            // if result is one, then set MS bit
+            if (OWSlotRead(&cy)) result |= 0x80;
+        }
+        *buf++ = result;
+
+        if (crcLen > 0)
         {
-            OneWireD_Write(0); //Drives DQ Low
-            CyDelayUs(C);
-            OneWireD_Write(1); // Releases the bus
-            CyDelayUs(D);
-        }   // Write '0' bit
-
-        // shift the data byte for the next bit
-        data >>= 1;
+            /* The CRC over a record including its CRC byte is 0 */
+            crc = CRC8_DALLAS_UPDATE(crc, result);
+            if (++n == crcLen)
+            {
+                if (crc != 0)
+                {
+                    OWSlotsEnd(&cy);
+                    return 1;
+                }
+                n = 0;
+            }
+        }
     }
+    OWSlotsEnd(&cy);
+    return 0;
+}
+/* Write tx, then read rx from the bus in one call, e.g. a function command
+ * and its answer. crcLen works as for OWReadBlock. */
+int OWTransfer(const unsigned char *tx, int txLen, unsigned char *rx, int rxLen, int crcLen)
+{
+    OWWriteBlock(tx, txLen);
+    return OWReadBlock(rx, rxLen, crcLen);
 }
+/* Write 1-Wire data byte. */
+void OWWriteByte(int data)
+{
+    unsigned char b = (unsigned char)data;
 
-/* Read 2 1-Wire data byte and return it. */
+    OWWriteBlock(&b, 1);
+}
+/* Read a 1-Wire data byte and return it. */
 unsigned char OWReadByte(void)
 {
-    int loop;
-    signed char result=0;
+    unsigned char b;
 
-    for (loop = 0; loop < 8; loop++)
+    OWReadBlock(&b, 1, 0);
+    return b;
+}
+/* Calculate the checksum, table driven (see crc8.c) */
+unsigned char OWCRC(unsigned char *pBuf, int len)
+{
+    return Crc8Dallas(pBuf, len, 0x00);
+}
+/* Perform one pass of the ROM search algorithm (Maxim AN187).
+ * Return 1 and leave the ROM code in ROM_NO when a device was found. */
+static int OWSearch(void)
+{
+    int id_bit_number = 1;
+    int last_zero = 0;
+    int rom_byte_number = 0;
+    unsigned char rom_byte_mask = 1;
+    int id_bit, cmp_id_bit, search_direction;
+    int search_result = 0;
+
+    if (!LastDeviceFlag)
     {
-        // shift the result to get it ready for the next bit
-        result >>= 1;
-        OneWireD_Write(0); //Drives DQ Low
-        CyDelayUs(A);
-        OneWireD_Write(1); // Releases the bus
-        CyDelayUs(E);
-        // if result is one, then set MS bit        
-        result |= (OneWireD_Read()) ? 0x80 : 0x00;
-        CyDelayUs(F); // Complete the time slot and 10us recovery
+        /* 0 means slave responded */
+        if (OWTouchReset())
+        {
+            LastDiscrepancy = 0;
+            LastDeviceFlag = 0;
+            return 0;
+        }
+        OWWriteByte(OW_SEARCH_ROM);
+
+        do
+        {
+            /* Read the bit and its complement */
+            id_bit = OWReadBit();
+            cmp_id_bit = OWReadBit();
+            /* No devices took part in this bit */
+            if (id_bit && cmp_id_bit) break;
 
+            if (id_bit != cmp_id_bit)
+                search_direction = id_bit;
+            else
+            {
+                /* Discrepancy: follow the path of the previous pass before
+                 * the last discrepancy, take 1 at it and 0 after it */
+                if (id_bit_number < LastDiscrepancy)
+                    search_direction = ((ROM_NO[rom_byte_number] & rom_byte_mask) != 0);
+                else
+                    search_direction = (id_bit_number == LastDiscrepancy);
+                if (search_direction == 0) last_zero = id_bit_number;
+            }
+
+            if (search_direction)
+                ROM_NO[rom_byte_number] |= rom_byte_mask;
+            else
+                ROM_NO[rom_byte_number] &= ~rom_byte_mask;
+            /* Deselect the devices that do not match the direction */
+            OWWriteBit(search_direction);
+
+            id_bit_number++;
+            rom_byte_mask <<= 1;
+            if (rom_byte_mask == 0)
+            {
+                rom_byte_number++;
+                rom_byte_mask = 1;
+            }
+        } while (rom_byte_number < OW_ROM_SIZE);
+
+        /* All 64 bits read and the CRC of the ROM is correct */
+        if (id_bit_number > 64 && OWCRC(ROM_NO, OW_ROM_SIZE) == 0)
+        {
+            LastDiscrepancy = last_zero;
+            if (LastDiscrepancy == 0) LastDeviceFlag = 1;
+            search_result = 1;
+        }
     }
-    return result;
+
+    if (!search_result || !ROM_NO[0])
+    {
+        LastDiscrepancy = 0;
+        LastDeviceFlag = 0;
+        search_result = 0;
+    }
+    return search_result;
 }
-/* Calculate the checksum */
-unsigned char OWCRC(unsigned char *pBuf, int len)
+/* Find the first device on the bus, copy its ROM into rom.
+ * Return 1 if a device was found, 0 otherwise. */
+int OWFirst(unsigned char *rom)
+{
+    int i;
+
+    LastDiscrepancy = 0;
+    LastDeviceFlag = 0;
+    if (!OWSearch()) return 0;
+    for (i = 0; i < OW_ROM_SIZE; i++) rom[i] = ROM_NO[i];
+    return 1;
+}
+/* Find the next device on the bus, copy its ROM into rom.
+ * Return 1 if a device was found, 0 when the search is done. */
+int OWNext(unsigned char *rom)
+{
+    int i;
+
+    if (!OWSearch()) return 0;
+    for (i = 0; i < OW_ROM_SIZE; i++) rom[i] = ROM_NO[i];
+    return 1;
+}
+/* Search the bus and fill the ROM table, return the number of devices.
+ * Interrupts are only held off during each search pass. */
+int OWEnumerate(void)
 {
-	unsigned char loop, i, shiftedBit;
-	unsigned char crc = 0x00;
-	
-	for(loop=0; loop<len; loop++)
-	{
-		crc = (crc ^ pBuf[loop]);
-		
-		for(i=8; i>0; i--)
-		{
-			shiftedBit= (crc & 0x01);
-			crc >>= 1;
-			
-			if(shiftedBit)
-			{
-				crc = (crc ^ 0x8c);
-			}
-		}
-	}
-	
-	return crc;
+    uint8 intState;
+    int found;
+    int i;
+
+    OWDevices.count = 0;
+    SetSpeed(&OWStandard);
+    intState = CyEnterCriticalSection();
+    found = OWFirst(OWDevices.rom[0]);
+    CyExitCriticalSection(intState);
+    while (found)
+    {
+        OWDevices.count++;
+        if (OWDevices.count >= OW_MAX_DEVICES) break;
+        intState = CyEnterCriticalSection();
+        found = OWNext(OWDevices.rom[OWDevices.count]);
+        CyExitCriticalSection(intState);
+    }
+    /* Find out which devices can run at overdrive speed */
+    for (i = 0; i < OWDevices.count; i++)
+    {
+        intState = CyEnterCriticalSection();
+        OWDevices.overdrive[i] = (OWMatchRomOverdrive(OWDevices.rom[i]) == 0 && OWTouchReset() == 0);
+        SetSpeed(&OWStandard);
+        CyExitCriticalSection(intState);
+    }
+    OWDevices.magic = OW_TABLE_MAGIC;
+    OWDevices.crc = OWCRC(&OWDevices.count, OW_TABLE_CRC_LEN);
+    return OWDevices.count;
+}
+/* Return 1 if the ROM table holds devices from an earlier search. */
+int OWTableValid(void)
+{
+    if (OWDevices.magic != OW_TABLE_MAGIC) return 0;
+    if (OWDevices.count == 0 || OWDevices.count > OW_MAX_DEVICES) return 0;
+    return OWCRC(&OWDevices.count, OW_TABLE_CRC_LEN) == OWDevices.crc;
+}
+/* Reset the bus and address a single device with Match ROM.
+ * Return 0 if the device can now take a function command. */
+int OWMatchRom(const unsigned char *rom)
+{
+    int i;
+
+    unsigned char tx[1 + OW_ROM_SIZE];
+
+    /* A standard speed reset brings every device back to standard speed */
+    SetSpeed(&OWStandard);
+    /* 0 means slave responded */
+    if (OWTouchReset()) return 1;
+    tx[0] = OW_MATCH_ROM;
+    for (i = 0; i < OW_ROM_SIZE; i++) tx[1 + i] = rom[i];
+    OWWriteBlock(tx, sizeof(tx));
+    return 0;
+}
+/* Address a single device with Overdrive Match ROM. The command goes at
+ * standard speed, the ROM and everything after it at overdrive speed.
+ * Return 0 if a slave responded to the reset. */
+int OWMatchRomOverdrive(const unsigned char *rom)
+{
+    SetSpeed(&OWStandard);
+    /* 0 means slave responded */
+    if (OWTouchReset()) return 1;
+    OWWriteByte(OW_OD_MATCH_ROM);
+    SetSpeed(&OWOverdrive);
+    OWWriteBlock(rom, OW_ROM_SIZE);
+    return 0;
+}
+/* Address one device of the ROM table, or every device with OW_ALL.
+ * Overdrive is used for devices that support it, and for a broadcast
+ * only if every device does. Return 0 if a slave responded. */
+int OWSelect(int dev)
+{
+    int i;
+    int overdrive = 1;
+
+    if (dev >= 0)
+    {
+        if (OWDevices.overdrive[dev]) return OWMatchRomOverdrive(OWDevices.rom[dev]);
+        return OWMatchRom(OWDevices.rom[dev]);
+    }
+    for (i = 0; i < OWDevices.count; i++) overdrive &= OWDevices.overdrive[i];
+    SetSpeed(&OWStandard);
+    /* 0 means slave responded */
+    if (OWTouchReset()) return 1;
+    /* Skip ROM addresses all devices */
+    if (OWDevices.count && overdrive)
+    {
+        OWWriteByte(OW_OD_SKIP_ROM);
+        SetSpeed(&OWOverdrive);
+    }
+    else OWWriteByte(OW_SKIP_ROM);
+    return 0;
+}
+/* Start a temperature conversion on every device at once.
+ * Return 0 if a slave responded. */
+int OWConvertAll(void)
+{
+    if (OWSelect(OW_ALL)) return 1;
+    OWWriteByte(OW_CONVERT_T);
+    return 0;
+}
+/* Read the scratchpad of one device into buf (9 bytes).
+ * Return 0 if the device answered and the CRC is correct. */
+int OWReadScratchpad(int dev, unsigned char *buf)
+{
+    const unsigned char cmd = OW_READ_SCRATCHPAD;
+
+    if (OWSelect(dev)) return 1;
+    return OWTransfer(&cmd, 1, buf, OW_SCRATCHPAD_SIZE, OW_SCRATCHPAD_SIZE);
+}
+/* Read the ROM of the only device on the bus with Read ROM.
+ * Return 0 if a slave responded and the CRC is correct. */
+int OWReadRom(unsigned char *rom)
+{
+    const unsigned char cmd = OW_READ_ROM;
+
+    SetSpeed(&OWStandard);
+    /* 0 means slave responded */
+    if (OWTouchReset()) return 1;
+    return OWTransfer(&cmd, 1, rom, OW_ROM_SIZE, OW_ROM_SIZE);
+}
+/* Set the resolution (9 to 12 bits) of one device, or of every device
+ * with OW_ALL. A single device keeps its alarm values, a broadcast
+ * writes the power-up ones. Return 0 if a slave responded. */
+int OWSetResolution(int dev, int bits)
+{
+    unsigned char sp[OW_SCRATCHPAD_SIZE];
+    unsigned char tx[4];
+    unsigned char th = OW_DEFAULT_TH;
+    unsigned char tl = OW_DEFAULT_TL;
+
+    if (bits < 9) bits = 9;
+    if (bits > 12) bits = 12;
+    if (dev >= 0)
+    {
+        if (OWReadScratchpad(dev, sp)) return 1;
+        th = sp[OW_SP_TH];
+        tl = sp[OW_SP_TL];
+    }
+    if (OWSelect(dev)) return 1;
+    /* TH, TL and the configuration register, in this order */
+    tx[0] = OW_WRITE_SCRATCHPAD;
+    tx[1] = th;
+    tx[2] = tl;
+    tx[3] = OW_CONFIG(bits);
+    OWWriteBlock(tx, sizeof(tx));
+    return 0;
+}
+/* Maximum conversion time of a DS18B20 for the given resolution,
+ * halved for every bit removed from 750 ms at 12 bits. */
+int OWConversionTimeMs(int bits)
+{
+    if (bits < 9) bits = 9;
+    if (bits > 12) bits = 12;
+    return 750 >> (12 - bits);
+}
+/* Poll one read slot after Convert T. The devices hold the bus low
+ * until their conversion is done, so 1 means every device has finished.
+ * Only works with externally powered devices. */
+int OWConversionDone(void)
+{
+    return OWReadBit();
+}
+/* Decode the temperature of a scratchpad in 1/16 degree Celsius.
+ * The bits left undefined at lower resolutions are cleared. */
+int OWTempFixed(const unsigned char *buf)
+{
+    int bits = OW_CONFIG_BITS(buf[OW_SP_CONFIG]);
+    int temp = (signed short)((buf[OW_SP_TEMP_MSB] << 8) | buf[OW_SP_TEMP_LSB]);
+
+    return temp & ~((1 << (12 - bits)) - 1);
 }
 
 /* [] END OF FILE */
@@ -9,15 +9,100 @@
  *
  * ========================================
 */
+#ifndef ONEWIRELIB_H
+#define ONEWIRELIB_H
+
 #include <project.h>
-/* Delays declaration */
-int A,B,C,D,E,F,G,H,I,J;
+/* Timing profile, every delay in 1/4 us (see Maxim AN126)
+ * a..f: write and read slots, g..j: reset and presence detect */
+typedef struct
+{
+    unsigned short a, b, c, d, e, f, g, h, i, j;
+} OWTiming;
+
+/* Standard speed: ~70 us slots, 560 us per byte
+ * Overdrive: ~10 us slots, 80 us per byte */
+extern const OWTiming OWStandard;
+extern const OWTiming OWOverdrive;
+extern const OWTiming *OWSpeed;
+
+/* ROM commands */
+#define OW_SEARCH_ROM       0xF0
+#define OW_READ_ROM         0x33
+#define OW_MATCH_ROM        0x55
+#define OW_SKIP_ROM         0xCC
+#define OW_OD_SKIP_ROM      0x3C
+#define OW_OD_MATCH_ROM     0x69
+/* DS18B20 function commands */
+#define OW_CONVERT_T        0x44
+#define OW_READ_SCRATCHPAD  0xBE
+#define OW_WRITE_SCRATCHPAD 0x4E
+#define OW_COPY_SCRATCHPAD  0x48
+
+/* DS18B20 scratchpad layout */
+#define OW_SP_TEMP_LSB      0
+#define OW_SP_TEMP_MSB      1
+#define OW_SP_TH            2
+#define OW_SP_TL            3
+#define OW_SP_CONFIG        4
+/* Power-up alarm values, used when no scratchpad was read */
+#define OW_DEFAULT_TH       0x4B
+#define OW_DEFAULT_TL       0x46
+/* Configuration register for 9 to 12 bit resolution: 0 R1 R0 1 1 1 1 1 */
+#define OW_CONFIG(bits)     ((((bits) - 9) << 5) | 0x1F)
+#define OW_CONFIG_BITS(cfg) ((((cfg) >> 5) & 0x03) + 9)
+
+/* Size of the ROM table, one entry per slave on the bus */
+#define OW_MAX_DEVICES      32
+#define OW_ROM_SIZE         8
+#define OW_SCRATCHPAD_SIZE  9
+/* Device index addressing every device with Skip ROM */
+#define OW_ALL              (-1)
+
+/* Table of the ROM codes found by the search.
+ * It is kept in a no-init section so it survives resets,
+ * the magic and the CRC tell whether the content is still valid. */
+typedef struct
+{
+    unsigned long magic;
+    unsigned char count;
+    unsigned char rom[OW_MAX_DEVICES][OW_ROM_SIZE];
+    unsigned char overdrive[OW_MAX_DEVICES];
+    unsigned char crc;
+} OWRomTable;
+
+extern OWRomTable OWDevices;
 
 /* Subprocesses definitions */
-void SetSpeed();
+void SetSpeed(const OWTiming *speed);
+unsigned long OWByteTimeNs(const OWTiming *t);
 int OWTouchReset(void);
+void OWWriteBit(int bit);
+int OWReadBit(void);
 void OWWriteByte(int data);
 unsigned char OWReadByte(void);
+void OWWriteBlock(const unsigned char *buf, int len);
+int OWReadBlock(unsigned char *buf, int len, int crcLen);
+int OWTransfer(const unsigned char *tx, int txLen, unsigned char *rx, int rxLen, int crcLen);
 unsigned char OWCRC(unsigned char *pBuf, int len);
+/* ROM search */
+int OWFirst(unsigned char *rom);
+int OWNext(unsigned char *rom);
+int OWEnumerate(void);
+int OWTableValid(void);
+/* Addressing and DS18B20 transactions */
+int OWMatchRom(const unsigned char *rom);
+int OWMatchRomOverdrive(const unsigned char *rom);
+int OWSelect(int dev);
+int OWConvertAll(void);
+int OWReadScratchpad(int dev, unsigned char *buf);
+int OWReadRom(unsigned char *rom);
+/* DS18B20 resolution and conversion */
+int OWSetResolution(int dev, int bits);
+int OWConversionTimeMs(int bits);
+int OWConversionDone(void);
+int OWTempFixed(const unsigned char *buf);
+
+#endif /* ONEWIRELIB_H */
 
 /* [] END OF FILE */
@@ -0,0 +1,160 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 5
+ * OneWire sensor driver for the acquisition core
+ * 
+ * Every device is its own sensor but they share the conversions:
+ * the first sensor that finds no fresh conversion broadcasts Convert T,
+ * the others wait for the same one. The bus does at most one operation
+ * (convert, one poll slot or one scratchpad read) per OW_SENSOR_STEP_US.
+ * 
+ * ========================================
+*/
+#include "owsensor.h"
+#include "systime.h"
+#include "stdio.h"
+
+#define FALSE  0
+#define TRUE   1
+
+volatile uint32 OWSensor_Ticks = 0;
+
+/* Sensor names, OneWire0 to OneWire31 */
+static char names[OW_MAX_DEVICES][12];
+/* Resolution set on the devices after a new search */
+static int bits;
+/* Conversion in progress, and the number of the last finished one */
+static uint8 converting = FALSE;
+static uint32 epoch = 0;
+/* Conversion each device was last read from */
+static uint32 readEpoch[OW_MAX_DEVICES];
+/* Time of the last bus operation */
+static uint32 lastStep;
+/* Step time over, waiting for an ADC interrupt, and the count last seen */
+static uint8 armed = FALSE;
+static uint32 seenTicks;
+
+/* Give every sensor its device index, name and rate */
+void OWSensor_Setup(Sensor *sensors, int count, uint32 periodUs, int resolution)
+{
+    int dev;
+
+    bits = resolution;
+    for (dev = 0; dev < count && dev < OW_MAX_DEVICES; dev++)
+    {
+        sprintf(names[dev], "OneWire%d", dev);
+        sensors[dev].name = names[dev];
+        sensors[dev].ops = &OWSensor;
+        sensors[dev].arg = dev;
+        sensors[dev].periodUs = periodUs;
+        sensors[dev].frac = 4;      // 1/16 degree Celsius
+        sensors[dev].decimals = 4;
+        readEpoch[dev] = epoch;
+    }
+}
+
+/* Return 1 if the bus may be used now, then the caller runs with
+ * interrupts disabled. Never waits: once the step time is over it
+ * returns 1 on the first call that finds exactly one ADC interrupt
+ * since the call before, so the bus starts early in an ADC period. */
+static int Step(void)
+{
+    uint32 ticks = OWSensor_Ticks;
+
+    if (!armed)
+    {
+        if (SysTime_Us() - lastStep < OW_SENSOR_STEP_US) return FALSE;
+        armed = TRUE;
+        seenTicks = ticks;
+        return FALSE;
+    }
+    /* A count, not a flag: none means the period is still running, more
+     * than one means the latest began too long ago to start the bus now */
+    if (ticks - seenTicks != 1u)
+    {
+        seenTicks = ticks;
+        return FALSE;
+    }
+    armed = FALSE;
+    lastStep = SysTime_Us();
+    return TRUE;
+}
+/* Broadcast Convert T, return 0 if a slave responded */
+static int Convert(void)
+{
+    int err;
+    int found;
+
+    /* Search again if no device was found before */
+    if (!OWTableValid())
+    {
+        /* Critical sections of its own, one per search pass */
+        found = OWEnumerate();
+        if (found)
+        {
+            CyGlobalIntDisable;
+            OWSetResolution(OW_ALL, bits);
+            CyGlobalIntEnable;
+        }
+    }
+    CyGlobalIntDisable;
+    /* One broadcast starts the conversion on every device */
+    err = OWConvertAll();
+    CyGlobalIntEnable;
+    if (err == 0) converting = TRUE;
+    return err;
+}
+
+static int OWStart(Sensor *s)
+{
+    if (s->arg >= OWDevices.count && OWTableValid()) return SENSOR_ABSENT;
+    /* A conversion is running or one this device has not read is ready */
+    if (converting || readEpoch[s->arg] != epoch) return 0;
+    if (!Step()) return 0;
+    return Convert() ? SENSOR_ERROR : 0;
+}
+static int OWPoll(Sensor *s)
+{
+    unsigned char buf[OW_SCRATCHPAD_SIZE];
+    int err;
+
+    if (s->arg >= OWDevices.count) return SENSOR_ABSENT;
+    if (!converting && readEpoch[s->arg] == epoch)
+    {
+        /* Read already, or the start found the bus busy: convert now */
+        if (Step() && Convert()) return SENSOR_ERROR;
+        return SENSOR_BUSY;
+    }
+    if (!Step()) return SENSOR_BUSY;
+    if (converting)
+    {
+        /* One read slot, the bus reads 1 once every device is done
+         * instead of waiting the worst case conversion time */
+        CyGlobalIntDisable;
+        err = OWConversionDone();
+        CyGlobalIntEnable;
+        if (!err) return SENSOR_BUSY;
+        converting = FALSE;
+        epoch++;
+        return SENSOR_BUSY;
+    }
+    readEpoch[s->arg] = epoch;
+    CyGlobalIntDisable;
+    /* 0 means slave responded with a correct CRC */
+    err = OWReadScratchpad(s->arg, buf);
+    CyGlobalIntEnable;
+    if (err) return SENSOR_ERROR;
+    /* Keep every fractional bit the resolution gives */
+    s->value = OWTempFixed(buf);
+    return SENSOR_READY;
+}
+
+const SensorOps OWSensor = { OWStart, OWPoll };
+
+/* [] END OF FILE */
@@ -0,0 +1,33 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 5
+ * OneWire sensor driver for the acquisition core
+ * 
+ * ========================================
+*/
+#ifndef OWSENSOR_H
+#define OWSENSOR_H
+
+#include "acq.h"
+#include "onewirelib.h"
+
+/* Time between two bus operations, a conversion is polled at this rate */
+#define OW_SENSOR_STEP_US   10000u
+
+/* One sensor per ROM table entry, arg is the device index */
+extern const SensorOps OWSensor;
+/* Counted by the ADC interrupt, a bus operation is put off until a poll
+ * finds it changed by one so it starts early in an ADC period */
+extern volatile uint32 OWSensor_Ticks;
+
+void OWSensor_Setup(Sensor *sensors, int count, uint32 periodUs, int resolution);
+
+#endif /* OWSENSOR_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,70 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 4
+ * SPI and I2C sensor drivers for the acquisition core
+ * 
+ * Both reads run in the background (SPI bus queue, I2C queue) and are
+ * only polled for completion.
+ * 
+ * ========================================
+*/
+#include "bussensors.h"
+#include "spibus.h"
+#include "i2cqueue.h"
+
+/* SPI temperature sensor word width */
+#define SPI_TEMP_MASK   0x0fffu
+
+/* SPI read: one word per burst, the word sent is ignored by the sensor */
+static const uint16 SPITx = 1;
+static uint16 SPIRx;
+static SPIDXfer SPIXfer = { &SPITx, &SPIRx, 1, NULL, SPID_IDLE };
+
+/* TC74 read: write command 00 (read temperature), then read 1 byte */
+static uint8 TC74Cmd = 0;
+static uint8 TC74Raw = 0;
+static I2CQXfer TC74Xfer = { 0, &TC74Cmd, 1, &TC74Raw, 1, NULL, I2CQ_IDLE };
+
+static int SpiStart(Sensor *s)
+{
+#if SPIB_PRESENT
+    return SPIB_Enqueue((uint8)s->arg, &SPIXfer) ? SENSOR_ERROR : 0;
+#else
+    (void) s;
+    return SPID_Transfer(&SPIXfer) ? SENSOR_ERROR : 0;
+#endif
+}
+static int SpiPoll(Sensor *s)
+{
+    (void) s;
+    if (SPIXfer.state == SPID_BUSY) return SENSOR_BUSY;
+    if (SPIXfer.state != SPID_DONE) return SENSOR_ERROR;
+    /* 12 significant bits, the reading is in 0.1 degree */
+    s->value = ((int32)(SPIRx & SPI_TEMP_MASK) << BUS_SENSOR_FRAC) / 10;
+    return SENSOR_READY;
+}
+
+static int TC74Start(Sensor *s)
+{
+    TC74Xfer.addr = (uint8)s->arg;
+    return I2CQ_Enqueue(&TC74Xfer) ? SENSOR_ERROR : 0;
+}
+static int TC74Poll(Sensor *s)
+{
+    if (I2CQ_Busy(&TC74Xfer)) return SENSOR_BUSY;
+    if (TC74Xfer.state != I2CQ_DONE) return SENSOR_ERROR;
+    /* The TC74 sends the temperature in two's complement */
+    s->value = (int32)(int8)TC74Raw << BUS_SENSOR_FRAC;
+    return SENSOR_READY;
+}
+
+const SensorOps SpiSensor_Temp = { SpiStart, SpiPoll };
+const SensorOps TC74Sensor = { TC74Start, TC74Poll };
+
+/* [] END OF FILE */
@@ -0,0 +1,30 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 4
+ * SPI and I2C sensor drivers for the acquisition core
+ * 
+ * ========================================
+*/
+#ifndef BUSSENSORS_H
+#define BUSSENSORS_H
+
+#include "acq.h"
+
+/* Q4 fixed point, 1/16 degree Celsius */
+#define BUS_SENSOR_FRAC 4
+
+/* SPI temperature sensor, 0.1 degree per count, arg is the SPI bus
+ * device, unused without the bus manager */
+extern const SensorOps SpiSensor_Temp;
+/* TC74 on I2C, arg is the 7-bit slave address */
+extern const SensorOps TC74Sensor;
+
+#endif /* BUSSENSORS_H */
+
+/* [] END OF FILE */
@@ -16,6 +16,10 @@
     /*Define your macro callbacks here */
     /*For more information, refer to the Writing Code topic in the PSoC Creator Help.*/
 
+    /* I2C transaction queue, see i2cqueue.c */
+    #define I2C_1_ISR_EXIT_CALLBACK
+    void I2C_1_ISR_ExitCallback(void);
+
     
 #endif /* CYAPICALLBACKS_H */   
 /* [] */
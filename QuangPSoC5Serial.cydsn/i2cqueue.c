@@ -0,0 +1,145 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 4
+ * Interrupt driven I2C master transaction queue
+ * 
+ * The payload bytes are moved by the I2C_1 component interrupt
+ * (MasterWriteBuf / MasterReadBuf), this module chains the phases and
+ * the queued transactions from the ISR exit callback, so the main loop
+ * only pays for I2CQ_Enqueue.
+ * 
+ * ========================================
+*/
+#include "i2cqueue.h"
+
+volatile uint32 I2CQ_Errors = 0;
+
+/* Ring of pending transactions, the head one is on the bus */
+static I2CQXfer *queue[I2CQ_SIZE];
+static volatile uint8 head = 0;
+static volatile uint8 tail = 0;
+
+/* Start the first phase of the transaction at the head of the queue */
+static void StartNext(void)
+{
+    I2CQXfer *x;
+    uint8 status;
+
+    while (head != tail)
+    {
+        x = queue[head & (I2CQ_SIZE - 1)];
+        I2C_1_MasterClearStatus();
+        if (x->wrLen)
+        {
+            x->state = I2CQ_WRITING;
+            status = I2C_1_MasterWriteBuf(x->addr, x->wrBuf, x->wrLen,
+                                          x->rdLen ? I2C_1_MODE_NO_STOP : I2C_1_MODE_COMPLETE_XFER);
+        }
+        else
+        {
+            x->state = I2CQ_READING;
+            status = I2C_1_MasterReadBuf(x->addr, x->rdBuf, x->rdLen, I2C_1_MODE_COMPLETE_XFER);
+        }
+        if (status == I2C_1_MSTR_NO_ERROR) return;
+
+        /* Could not start, drop it and try the next one */
+        x->state = I2CQ_ERROR;
+        I2CQ_Errors++;
+        head++;
+        if (x->callback) x->callback(x);
+    }
+}
+/* Finish the head transaction and move on */
+static void Complete(I2CQXfer *x, uint8 state)
+{
+    x->state = state;
+    if (state == I2CQ_ERROR) I2CQ_Errors++;
+    head++;
+    if (x->callback) x->callback(x);
+    StartNext();
+}
+
+/* Subprocesses */
+void I2CQ_Start(void)
+{
+    head = 0;
+    tail = 0;
+    I2C_1_Start();
+}
+/* Queue a transaction, return 0 on success, 1 if the queue is full or
+ * the transaction is already queued. */
+int I2CQ_Enqueue(I2CQXfer *xfer)
+{
+    uint8 intState;
+    int idle;
+
+    if (I2CQ_Busy(xfer)) return 1;
+    intState = CyEnterCriticalSection();
+    if ((uint8)(tail - head) >= I2CQ_SIZE)
+    {
+        CyExitCriticalSection(intState);
+        return 1;
+    }
+    xfer->state = I2CQ_QUEUED;
+    idle = (head == tail);
+    queue[tail & (I2CQ_SIZE - 1)] = xfer;
+    tail++;
+    /* Nothing on the bus, nothing will call us back: start it here */
+    if (idle) StartNext();
+    CyExitCriticalSection(intState);
+    return 0;
+}
+/* Return 1 while the transaction is queued or on the bus */
+int I2CQ_Busy(const I2CQXfer *xfer)
+{
+    uint8 state = xfer->state;
+
+    return state == I2CQ_QUEUED || state == I2CQ_WRITING || state == I2CQ_READING;
+}
+/* Move the head transaction on, called at the end of the I2C interrupt */
+void I2CQ_Service(void)
+{
+    I2CQXfer *x;
+    uint8 status;
+
+    if (head == tail) return;
+    x = queue[head & (I2CQ_SIZE - 1)];
+    status = I2C_1_MasterStatus();
+
+    if (status & I2C_1_MSTAT_ERR_XFER)
+    {
+        I2C_1_MasterClearStatus();
+        Complete(x, I2CQ_ERROR);
+    }
+    else if (x->state == I2CQ_WRITING && (status & I2C_1_MSTAT_WR_CMPLT))
+    {
+        I2C_1_MasterClearStatus();
+        if (x->rdLen == 0) Complete(x, I2CQ_DONE);
+        else
+        {
+            /* Read phase with a repeated start */
+            x->state = I2CQ_READING;
+            if (I2C_1_MasterReadBuf(x->addr, x->rdBuf, x->rdLen, I2C_1_MODE_REPEAT_START) != I2C_1_MSTR_NO_ERROR)
+                Complete(x, I2CQ_ERROR);
+        }
+    }
+    else if (x->state == I2CQ_READING && (status & I2C_1_MSTAT_RD_CMPLT))
+    {
+        I2C_1_MasterClearStatus();
+        Complete(x, I2CQ_DONE);
+    }
+}
+
+/* I2C_1 interrupt exit hook, enabled in cyapicallbacks.h */
+void I2C_1_ISR_ExitCallback(void)
+{
+    I2CQ_Service();
+}
+
+/* [] END OF FILE */
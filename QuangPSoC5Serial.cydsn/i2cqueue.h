@@ -0,0 +1,57 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 4
+ * Interrupt driven I2C master transaction queue
+ * 
+ * ========================================
+*/
+#ifndef I2CQUEUE_H
+#define I2CQUEUE_H
+
+#include <project.h>
+
+/* Number of transactions that can wait, power of 2 */
+#define I2CQ_SIZE       8
+
+/* Transaction states */
+#define I2CQ_IDLE       0
+#define I2CQ_QUEUED     1
+#define I2CQ_WRITING    2
+#define I2CQ_READING    3
+#define I2CQ_DONE       4
+#define I2CQ_ERROR      5
+
+typedef struct I2CQXfer I2CQXfer;
+/* Completion callback, runs in the I2C interrupt */
+typedef void (*I2CQCallback)(I2CQXfer *xfer);
+
+/* One write-then-read transaction. Either part can be empty,
+ * the read follows the write with a repeated start. */
+struct I2CQXfer
+{
+    uint8 addr;
+    uint8 *wrBuf;
+    uint8 wrLen;
+    uint8 *rdBuf;
+    uint8 rdLen;
+    I2CQCallback callback;
+    volatile uint8 state;
+};
+
+/* Transactions that ended with an error */
+extern volatile uint32 I2CQ_Errors;
+
+void I2CQ_Start(void);
+int I2CQ_Enqueue(I2CQXfer *xfer);
+int I2CQ_Busy(const I2CQXfer *xfer);
+void I2CQ_Service(void);
+
+#endif /* I2CQUEUE_H */
+
+/* [] END OF FILE */
@@ -15,19 +15,68 @@
 #include <project.h>
 #include "stdio.h"
 #include "stdlib.h"
+#include "i2cqueue.h"
+#include "spidma.h"
+#include "spibus.h"
+#include "systime.h"
+#include "ratesched.h"
+#include "coop.h"
+#include "idle.h"
+#include "acq.h"
+#include "adcsensor.h"
+#include "bussensors.h"
 
 /* Project Defines */
-#define FALSE  0
-#define TRUE   1
-#define TRANSMIT_BUFFER_SIZE 40
-#define THRESHOLD 5000
 #define SLAVE_ADDR 0x4A
+/* Sensor periods in microseconds.
+ * The ADC converts at 10 ksps, the TC74 updates 8 times per second. */
+#define ADC_PERIOD_US   100u
+#define SPI_PERIOD_US   100000u
+#define I2C_PERIOD_US   125000u
+/* Output window, one line every 0.5 s */
+#define EMIT_PERIOD_US  500000u
+/* Commands are single characters, the UART FIFO holds 4 */
+#define CONSOLE_POLL_US 1000u
 
-/* ISR Handler */
-CY_ISR_PROTO(ADC_ISR_Handler);
+/* SPI slaves.
+ * name, select bits, CPOL, word width, clock divider (24 MHz / 8 / 2 = 1.5 Mbit/s) */
+#if SPIB_PRESENT
+static SPIBDevice SPIDevices[] =
+{
+    { "Temp", 0x01, 0, 12, 8 },
+};
+#define SPI_DEV_COUNT   (sizeof(SPIDevices)/sizeof(SPIDevices[0]))
+#endif
+#define SPI_TEMP        0
+
+/* name, driver, argument, period, fractional bits, decimals, latest */
+static Sensor Sensors[] =
+{
+    { "ADC", &AdcSensor_mV, 0, ADC_PERIOD_US, ADC_SENSOR_FRAC, 0, 1 },
+    { "Temperature", &AdcSensor_Temp, 1, ADC_PERIOD_US, ADC_SENSOR_FRAC, 1 },
+    { "SPI", &SpiSensor_Temp, SPI_TEMP, SPI_PERIOD_US, BUS_SENSOR_FRAC, 1 },
+    { "I2C", &TC74Sensor, SLAVE_ADDR, I2C_PERIOD_US, BUS_SENSOR_FRAC, 0 },
+};
+#define SENSOR_COUNT (sizeof(Sensors)/sizeof(Sensors[0]))
+
+/* name, job, period, phase */
+static RateJob Jobs[] =
+{
+    { "Acq", Acq_Run, ADC_PERIOD_US, 0u },
+    { "Emit", Acq_Emit, EMIT_PERIOD_US, 0u },
+};
+#define JOB_COUNT (sizeof(Jobs)/sizeof(Jobs[0]))
 
-/* Flag for interrupt */
-static volatile CYBIT ADC_flag = FALSE;
+static void Console(void);
+static void Rates(void);
+
+/* name, task */
+static CoopTask Tasks[] =
+{
+    { "Console", Console },
+    { "Rates", Rates },
+};
+#define TASK_COUNT (sizeof(Tasks)/sizeof(Tasks[0]))
 
 /*******************************************************************************
 * Function Name: main
@@ -35,13 +84,16 @@ static volatile CYBIT ADC_flag = FALSE;
 *
 * Summary:
 *  main() performs following functions:
-*  1: Starts the ADC and UART components.
-*  2: Checks for ADC end of conversion.  Stores latest result in output
-*     if conversion complete.
+*  1: Starts the ADC, SPI, I2C and UART components.
+*  2: Runs the acquisition core, which reads every sensor at its own rate
+*     and sends the averages every 0.5 s, see Sensors.
 *  3: Checks for UART input.
 *     On 'C' or 'c' received: transmits the last sample via the UART.
 *     On 'S' or 's' received: continuously transmits samples as they are completed.
 *     On 'X' or 'x' received: stops continuously transmitting samples.
+*     On 'R' or 'r' received: transmits the job, sensor, SPI bus, task and sleep statistics.
+*     On 'T' or 't' received: transmits the SPI throughput per clock rate.
+*  The console and the jobs are cooperative tasks, see Tasks.
 *
 * Parameters:
 *  None.
@@ -53,169 +105,77 @@ static volatile CYBIT ADC_flag = FALSE;
 int main()
 {
     CyGlobalIntEnable;
-    /* Variable to store ADC result */
-    uint32 ADCOutput;
-    /* Variable to store the SPI data */
-    uint16 SPIOutput;
-    /* value to store the buffer data from the slave */
-    uint8 I2COutput;    
-    /* Variable to store UART received character */
-    uint8 Ch;
-    /* Flags used to store transmit data commands */
-    uint8 ContinuouslySendData;
-    uint8 SendSingleByte;
-    /* values for the down-sampling */
-    uint32 sum = 0;
-    uint32 cnt = 0;
-    /* values to send to the Tx buffer of SPI */
-    uint16 SPIdummy = 1;
-    /* Transmit Buffer */
-    char TransmitBuffer[TRANSMIT_BUFFER_SIZE];
     
     /* Start the components */
-    ADC_DelSig_1_Start();
+    AdcSensor_Start();
     UART_1_Start();
-    SPIM_1_Start();
-    I2C_1_Start();
+    SPID_Start();
+    I2CQ_Start();
+    SysTime_Start();
     
     /* Set drive mode */
     SDA_SetDriveMode(SDA_DM_RES_UP);
     SCL_SetDriveMode(SCL_DM_RES_UP);
-    
-    /* Initialize Variables */
-    ContinuouslySendData = FALSE;
-    SendSingleByte = FALSE;
-    
-    /* Start the ADC conversion */
-    ADC_DelSig_1_StartConvert();    
          
     /* Send message to verify COM port is connected properly */
     UART_1_PutString("COM Port Open");
     
-    /* Start the ISR */
-    ADC_DelSig_1_IRQ_StartEx(ADC_ISR_Handler);
+#if SPIB_PRESENT
+    /* Hand the slaves to the SPI bus manager */
+    SPIB_Start(SPIDevices, SPI_DEV_COUNT);
+#endif
+    /* First read of every sensor and first release of every job */
+    Acq_Init(Sensors, SENSOR_COUNT, UART_1_PutString);
+    RateSched_Init(Jobs, JOB_COUNT);
+    Coop_Init(Tasks, TASK_COUNT);
+    /* The CPU waits for interrupts between tasks, the buses and the UART run on */
+    Idle_Start(0u, 0u);
     
     for(;;)
     {        
-        /* Non-blocking call to get the latest data recieved  */
-        Ch = UART_1_GetChar();
-        
-        /* Set flags based on UART command */
-        switch(Ch)
-        {
-            case 0:
-                /* No new data was recieved */
-                break;
-            case 'C':
-            case 'c':
-                SendSingleByte = TRUE;
-                break;
-            case 'S':
-            case 's':
-                ContinuouslySendData = TRUE;
-                break;
-            case 'X':
-            case 'x':
-                ContinuouslySendData = FALSE;
-                break;
-            default:
-                /* Place error handling code here */
-                break;    
-        }
-        /*---------------I2C---------------*/
-        /* Send start to the slave */
-        /* Check master's status
-         * No error bits set */
-        if (I2C_1_MasterSendStart(SLAVE_ADDR, I2C_1_WRITE_XFER_MODE) == I2C_1_MSTR_NO_ERROR)
-        {
-            /* Write command 00 to read the temperature */
-            I2C_1_MasterWriteByte(0);
-            /* Resend the slave address */
-            if (I2C_1_MasterSendRestart(SLAVE_ADDR, I2C_1_READ_XFER_MODE) == I2C_1_MSTR_NO_ERROR) 
-                /* Read the TEMP data and generate NACK */
-                I2COutput = I2C_1_MasterReadByte(I2C_1_NAK_DATA);
-            /* End transaction */
-            I2C_1_MasterSendStop();
-            /* Check 7th bit to determine positive or negative */
-            if ((I2COutput & 0x80) != 0)
-            {
-                int temp = (int)(I2COutput & 0x7F);
-                temp-=128;
-                I2COutput = temp;
-            }
-        }
-        /*---------------SPI---------------*/
-        if (SPIM_1_ReadTxStatus() & SPIM_1_STS_TX_FIFO_EMPTY)
-        {
-             /* Driving SS high with software */
-            SPISS_1_Write(FALSE); // anttikp: low active!!!
-            /* Write to Tx buffer */
-            SPIM_1_WriteTxData(SPIdummy);
-            while(!(SPIM_1_ReadRxStatus() & SPIM_1_STS_RX_FIFO_NOT_EMPTY)); // wait here until RX buffer is not empty
-            /* Check for something to be sent to the Rx buffer
-             * Rx status register bit 5 is set */
-            /* Driving SS low with software */
-            SPISS_1_Write(TRUE); // setting SS inactive
-            /* Read data from Rx buffer */
-            SPIOutput = (SPIM_1_ReadRxData()) & 0x0fff; // using 15-bit SPIM 
-        }
-        /* Check to see if an ADC conversion has completed */
-        /* Check to see if Tx buffer is empty 
-         * by comparing with a mask
-         * The compare value is to check whether bit 1 was set */
-        if(ADC_DelSig_1_IsEndConversion(ADC_DelSig_1_RETURN_STATUS))
-        {
-            /* Use the GetResult16 API to get an 8 bit unsigned result in
-             * single ended mode.  The API CountsTo_mVolts is then used
-             * to convert the ADC counts into mV before transmitting via
-             * the UART.  See the datasheet API description for more
-             * details */
-            ADCOutput = ADC_DelSig_1_CountsTo_mVolts(ADC_DelSig_1_GetResult16());
-
-            /* Send data based on last UART command */
-            if(SendSingleByte || ContinuouslySendData)
-            {
-                /* Flag set => reached 0.5s threshold */
-                if (ADC_flag) 
-                {
-                    /* Format ADC result for transmition */
-                    /* The conversion of ADC value to temperature for this sensor is 10mV = 1 degree Celcius */
-                    sprintf(TransmitBuffer, "{ ADC :%lu , Temperature :%.1f , SPI : %.1f , I2C :%d }\r\n", ADCOutput,(float) sum/cnt/10, (float) SPIOutput/10, I2COutput);
-                    /* Send out the data */
-                    UART_1_PutString(TransmitBuffer);
-                    /* Reset flags and values */
-                    ADC_flag = FALSE;
-                    sum = 0;
-                    cnt = 0;
-                } //output data 
-                else 
-                {
-                    sum+=ADCOutput;
-                    cnt++;
-                } //gather data
-                /* Reset the send once flag */
-                SendSingleByte = FALSE;
-            }
-        }
-
+        if (Coop_Run() == 0u) Idle_Run();
     }
 }
-/* Subprocesses */
-
-/* ISR routines */
-CY_ISR(ADC_ISR_Handler)
+/* Tasks */
+static void Console(void)
 {
-    static uint32 clk = 0;
-    /* Threshold = defined sample per seconds / sample rate 
-     * The clock only runs when the flag is not set (calculation for output is finished 
-     * This can result in data being captured but ignored completely 
-     * However, the integrity of the data will be preserved */
-    if (clk < THRESHOLD && !ADC_flag) clk++;
-    else 
+    /* Non-blocking call to get the latest data recieved  */
+    uint8 Ch = UART_1_GetChar();
+    
+    /* Set flags based on UART command */
+    switch(Ch)
     {
-        clk = 0;
-        ADC_flag = TRUE;
-    } //reset clock and set flags
-    /* The interupt is automatically reset in this case */
+        case 0:
+            /* No new data was recieved */
+            break;
+        case 'R':
+        case 'r':
+            /* Report runs, deadline misses and jitter of each job,
+             * then latency of each task and the idle share */
+            RateSched_Report(Jobs, JOB_COUNT, UART_1_PutString);
+            Acq_Report();
+#if SPIB_PRESENT
+            SPIB_Report(UART_1_PutString);
+#endif
+            Coop_Report(UART_1_PutString);
+            Idle_Report(UART_1_PutString);
+            break;
+        case 'T':
+        case 't':
+            /* SPI throughput at several clock rates */
+            SPID_Benchmark(UART_1_PutString);
+            break;
+        default:
+            /* 'C', 'S' and 'X' are handled by the acquisition core */
+            Acq_Command(Ch);
+            break;    
+    }
+    Coop_Sleep(CONSOLE_POLL_US);
+}
+/* Run the jobs that are due, then sleep until the next release */
+static void Rates(void)
+{
+    Coop_SleepUntil(RateSched_Run(Jobs, JOB_COUNT));
 }
+
 /* [] END OF FILE */
@@ -0,0 +1,202 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 4
+ * Multi-device SPI bus manager on top of the DMA transfers
+ * 
+ * Schematic: the SPIM_1 ss output is ANDed with the low SPISel control
+ * register bits, one bit per slave, and SCLK goes through an XOR with
+ * SPISel bit 7 for the devices with CPOL 1. The SPIM frame (16 bits) and
+ * CPHA are fixed at build time, narrower devices get 16-bit frames and
+ * their words are masked to their width.
+ * 
+ * The next transfer is started from the DMA done interrupt. Transfers
+ * to the same device run back to back, SPISel and the clock divider are
+ * only written when the device changes to one with other settings.
+ * 
+ * ========================================
+*/
+#include "spibus.h"
+
+#if SPIB_PRESENT
+#include "systime.h"
+#include "stdio.h"
+
+#define SPIB_CPOL_BIT   0x80u
+
+static SPIBDevice *table;
+static uint8 tableCount;
+/* Device on the bus and transfers it had in a row */
+static uint8 current;
+static uint8 batch;
+static uint8 running = 0;
+/* Settings in the hardware now */
+static uint8 selReg;
+static uint16 divReg;
+/* Transfer handed to the DMA layer and the user transfer behind it */
+static SPIDXfer busXfer;
+static SPIDXfer *userXfer;
+/* Bus busy time since the last report */
+static uint32 busyUs, t0, since;
+static uint32 switches;
+
+static void BusDone(SPIDXfer *x);
+
+/* Select dev with as few register writes as possible */
+static void Configure(const SPIBDevice *d)
+{
+    uint8 sel = d->select | (d->cpol ? SPIB_CPOL_BIT : 0u);
+
+    if (sel != selReg)
+    {
+        selReg = sel;
+        SPISel_Write(sel);
+    }
+    if (d->divider != divReg)
+    {
+        divReg = d->divider;
+        SPIM_1_IntClock_SetDividerValue(d->divider);
+    }
+}
+/* Start the head transfer of the next device with work. Stays on the
+ * current device for up to SPIB_BATCH transfers. Interrupts are off. */
+static void StartNext(void)
+{
+    SPIBDevice *d;
+    uint8 i, dev;
+
+    running = 0;
+    for (i = 0u; i <= tableCount; i++)
+    {
+        /* i == 0 is the current device, then the others in turn */
+        if (i == 0u && batch >= SPIB_BATCH) continue;
+        dev = (uint8)((current + i) % tableCount);
+        d = &table[dev];
+        if (d->head == d->tail) continue;
+
+        if (dev != current || i != 0u)
+        {
+            if (dev != current) switches++;
+            current = dev;
+            batch = 0u;
+        }
+        batch++;
+        userXfer = d->queue[d->head & (SPIB_QUEUE - 1)];
+        Configure(d);
+        busXfer.txBuf = userXfer->txBuf;
+        busXfer.rxBuf = userXfer->rxBuf;
+        busXfer.len = userXfer->len;
+        busXfer.callback = BusDone;
+        t0 = SysTime_Us();
+        /* Set first, a polled transfer finishes and starts the next
+         * one before it returns */
+        running = 1;
+        if (SPID_Transfer(&busXfer) == 0) return;
+        running = 0;
+        /* Rejected (length), drop it and look again */
+        d->head++;
+        userXfer->state = SPID_ERROR;
+        if (userXfer->callback) userXfer->callback(userXfer);
+    }
+}
+/* DMA done: finish the user transfer and start the next one */
+static void BusDone(SPIDXfer *x)
+{
+    SPIBDevice *d = &table[current];
+    SPIDXfer *u = userXfer;
+    uint16 mask, i;
+
+    (void) x;
+    busyUs += SysTime_Us() - t0;
+    d->head++;
+    d->xfers++;
+    d->words += u->len;
+    if (u->rxBuf && d->width < 16u)
+    {
+        mask = (uint16)((1u << d->width) - 1u);
+        for (i = 0u; i < u->len; i++) u->rxBuf[i] &= mask;
+    }
+    u->state = SPID_DONE;
+    if (u->callback) u->callback(u);
+    StartNext();
+}
+
+/* Subprocesses */
+/* Take over a device table, SPID_Start must have run */
+void SPIB_Start(SPIBDevice *devices, uint8 count)
+{
+    uint8 i;
+
+    table = devices;
+    tableCount = count;
+    for (i = 0u; i < count; i++)
+    {
+        devices[i].head = 0u;
+        devices[i].tail = 0u;
+        devices[i].xfers = 0u;
+        devices[i].words = 0u;
+    }
+    current = 0u;
+    batch = 0u;
+    /* Force the first device to write its settings */
+    selReg = 0xFFu;
+    divReg = 0u;
+    SPISel_Write(0u);
+    since = SysTime_Us();
+}
+/* Queue a transfer for device dev, return 0 on success, 1 if the queue
+ * is full or the transfer is already waiting. */
+int SPIB_Enqueue(uint8 dev, SPIDXfer *xfer)
+{
+    SPIBDevice *d = &table[dev];
+    uint8 intState;
+
+    if (dev >= tableCount || xfer->state == SPID_BUSY) return 1;
+    intState = CyEnterCriticalSection();
+    if ((uint8)(d->tail - d->head) >= SPIB_QUEUE)
+    {
+        CyExitCriticalSection(intState);
+        return 1;
+    }
+    xfer->state = SPID_BUSY;
+    d->queue[d->tail & (SPIB_QUEUE - 1)] = xfer;
+    d->tail++;
+    /* Bus idle, nothing will call us back: start it here */
+    if (!running) StartNext();
+    CyExitCriticalSection(intState);
+    return 0;
+}
+/* Print the bus utilization and the traffic of every device since the
+ * last report */
+void SPIB_Report(void (*out)(const char *s))
+{
+    char buf[64];
+    uint32 now, busy, sw, permille;
+    uint8 intState, i;
+
+    intState = CyEnterCriticalSection();
+    now = SysTime_Us();
+    busy = busyUs;
+    sw = switches;
+    busyUs = 0u;
+    switches = 0u;
+    permille = busy / ((now - since) / 1000u + 1u);
+    since = now;
+    CyExitCriticalSection(intState);
+
+    sprintf(buf, "SPI bus %3lu.%lu %% busy, %lu switches\r\n", permille / 10u, permille % 10u, sw);
+    out(buf);
+    for (i = 0u; i < tableCount; i++)
+    {
+        sprintf(buf, "  %-8s %8lu xfers %8lu words\r\n", table[i].name, table[i].xfers, table[i].words);
+        out(buf);
+    }
+}
+#endif /* SPIB_PRESENT */
+
+/* [] END OF FILE */
@@ -0,0 +1,58 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 4
+ * Multi-device SPI bus manager on top of the DMA transfers
+ * 
+ * ========================================
+*/
+#ifndef SPIBUS_H
+#define SPIBUS_H
+
+#include <project.h>
+#include "spidma.h"
+
+/* The manager needs the SPISel control register, the SS gating and the
+ * SCLK XOR of the schematic. Without them it is left out and the one
+ * slave on SPISS_1 is read with SPID_Transfer. */
+#if defined(SPISel_Control_PTR)
+    #define SPIB_PRESENT    1
+#else
+    #define SPIB_PRESENT    0
+#endif
+
+/* Transfers that can wait per device, power of 2 */
+#define SPIB_QUEUE      4
+/* Transfers in a row on one device before the others get a turn */
+#define SPIB_BATCH      4
+
+/* One slave on the bus. name, select, cpol, width and divider are set
+ * by the user, the rest is kept by the manager. */
+typedef struct
+{
+    const char *name;
+    uint8 select;       /* SPISel bits that route SS to this device */
+    uint8 cpol;         /* 1 inverts SCLK (SPISel bit 7) */
+    uint8 width;        /* significant bits per word, 1 to 16 */
+    uint16 divider;     /* SPIM_1_IntClock divider, bit rate = BUS_CLK / divider / 2 */
+    /* Queue of transfers waiting for the bus */
+    SPIDXfer *queue[SPIB_QUEUE];
+    volatile uint8 head;
+    volatile uint8 tail;
+    /* Statistics */
+    uint32 xfers;
+    uint32 words;
+} SPIBDevice;
+
+void SPIB_Start(SPIBDevice *devices, uint8 count);
+int SPIB_Enqueue(uint8 dev, SPIDXfer *xfer);
+void SPIB_Report(void (*out)(const char *s));
+
+#endif /* SPIBUS_H */
+
+/* [] END OF FILE */
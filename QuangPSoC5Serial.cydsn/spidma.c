@@ -0,0 +1,161 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 4
+ * DMA driven SPI master burst transfers
+ * 
+ * With DMA: DMA_SPI_TX is requested by the SPIM_1 tx_interrupt
+ * (TX FIFO not full) and DMA_SPI_RX by the rx_interrupt (RX FIFO not
+ * empty). The nrq of DMA_SPI_RX goes to isr_spi_done. SPIM_1 drives the
+ * SS pin itself, it stays low while the TX FIFO has data, which the TX
+ * channel keeps filled for the whole burst.
+ * 
+ * Without the DMA channels in the schematic the burst is polled word by
+ * word with SPISS_1 held low by software, as before. SPID_Transfer then
+ * returns after the callback has run.
+ * 
+ * ========================================
+*/
+#include "spidma.h"
+#include "systime.h"
+#include "stdio.h"
+
+/* Two bytes per request, one request per burst */
+#define SPID_BYTES_PER_BURST    2u
+#define SPID_REQUEST_PER_BURST  1u
+
+/* Benchmark burst length in words */
+#define SPID_BENCH_WORDS        256u
+
+static SPIDXfer *volatile current = NULL;
+
+#if defined(DMA_SPI_TX__TD_TERMOUT_EN)
+#if (SPIM_1_DATA_WIDTH <= 8u)
+    #error "spidma: the DMA moves 16-bit words, SPIM_1 needs more than 8 data bits"
+#endif
+static uint8 txChan, rxChan;
+static uint8 txTd, rxTd;
+/* Source of the clocked out words and sink of the dropped ones */
+static const uint16 zero = 0u;
+static uint16 sink;
+
+CY_ISR_PROTO(SPID_Done_Handler);
+#endif
+
+/* Subprocesses */
+void SPID_Start(void)
+{
+    SPIM_1_Start();
+#if defined(DMA_SPI_TX__TD_TERMOUT_EN)
+    txChan = DMA_SPI_TX_DmaInitialize(SPID_BYTES_PER_BURST, SPID_REQUEST_PER_BURST,
+                                      HI16(CYDEV_SRAM_BASE), HI16(CYDEV_PERIPH_BASE));
+    rxChan = DMA_SPI_RX_DmaInitialize(SPID_BYTES_PER_BURST, SPID_REQUEST_PER_BURST,
+                                      HI16(CYDEV_PERIPH_BASE), HI16(CYDEV_SRAM_BASE));
+    txTd = CyDmaTdAllocate();
+    rxTd = CyDmaTdAllocate();
+    isr_spi_done_StartEx(SPID_Done_Handler);
+#else
+    SPISS_1_Write(1u);
+#endif
+}
+/* Start a burst, return 0 on success, 1 if the bus is busy or the
+ * burst is too long. With DMA the CPU is free until the callback. */
+int SPID_Transfer(SPIDXfer *xfer)
+{
+#if defined(DMA_SPI_TX__TD_TERMOUT_EN)
+    uint16 bytes = xfer->len * SPID_BYTES_PER_BURST;
+#else
+    uint16 i, word;
+#endif
+
+    if (xfer->len == 0u || xfer->len > SPID_MAX_WORDS) return 1;
+    if (current != NULL) return 1;
+    current = xfer;
+    xfer->state = SPID_BUSY;
+
+#if defined(DMA_SPI_TX__TD_TERMOUT_EN)
+
+    /* RX first so no word is missed once TX starts the clock */
+    CyDmaTdSetConfiguration(rxTd, bytes, CY_DMA_DISABLE_TD,
+                            DMA_SPI_RX__TD_TERMOUT_EN | (xfer->rxBuf ? TD_INC_DST_ADR : 0u));
+    CyDmaTdSetAddress(rxTd, LO16((uint32)SPIM_1_RXDATA_PTR),
+                      LO16((uint32)(xfer->rxBuf ? xfer->rxBuf : &sink)));
+    CyDmaChSetInitialTd(rxChan, rxTd);
+    CyDmaChEnable(rxChan, 1u);
+
+    CyDmaTdSetConfiguration(txTd, bytes, CY_DMA_DISABLE_TD, xfer->txBuf ? TD_INC_SRC_ADR : 0u);
+    CyDmaTdSetAddress(txTd, LO16((uint32)(xfer->txBuf ? xfer->txBuf : &zero)),
+                      LO16((uint32)SPIM_1_TXDATA_PTR));
+    CyDmaChSetInitialTd(txChan, txTd);
+    CyDmaChEnable(txChan, 1u);
+#else
+    /* Driving SS low with software, low active */
+    SPISS_1_Write(0u);
+    for (i = 0u; i < xfer->len; i++)
+    {
+        SPIM_1_WriteTxData(xfer->txBuf ? xfer->txBuf[i] : 0u);
+        /* Wait until the word is clocked in */
+        while (!(SPIM_1_ReadRxStatus() & SPIM_1_STS_RX_FIFO_NOT_EMPTY)) {}
+        word = SPIM_1_ReadRxData();
+        if (xfer->rxBuf) xfer->rxBuf[i] = word;
+    }
+    SPISS_1_Write(1u);
+    current = NULL;
+    xfer->state = SPID_DONE;
+    if (xfer->callback) xfer->callback(xfer);
+#endif
+    return 0;
+}
+/* Return 1 while a burst is on the bus */
+int SPID_Busy(void)
+{
+    return current != NULL;
+}
+/* Time a burst at several SPIM clock dividers and print the throughput.
+ * Blocks the caller, run it from the main loop only. */
+void SPID_Benchmark(void (*out)(const char *s))
+{
+    static const uint16 dividers[] = { 2u, 4u, 8u, 16u, 32u };
+    static SPIDXfer bench = { NULL, NULL, SPID_BENCH_WORDS, NULL, SPID_IDLE };
+    uint16 saved = SPIM_1_IntClock_GetDividerRegister() + 1u;
+    uint32 clk, t0, us;
+    char buf[64];
+    uint8 i;
+
+    while (SPID_Busy()) {}
+    for (i = 0u; i < sizeof(dividers) / sizeof(dividers[0]); i++)
+    {
+        SPIM_1_IntClock_SetDividerValue(dividers[i]);
+        /* The SPIM clock runs at twice the bit rate */
+        clk = BCLK__BUS_CLK__HZ / dividers[i];
+        t0 = SysTime_Us();
+        if (SPID_Transfer(&bench)) break;
+        while (SPID_Busy()) {}
+        us = SysTime_Us() - t0;
+        sprintf(buf, "SPI %7lu bit/s: %5lu us, %7lu bit/s\r\n", clk / 2u, us,
+                us ? (uint32)SPID_BENCH_WORDS * SPIM_1_DATA_WIDTH * 1000u / us * 1000u : 0u);
+        out(buf);
+    }
+    SPIM_1_IntClock_SetDividerValue(saved);
+}
+
+#if defined(DMA_SPI_TX__TD_TERMOUT_EN)
+/* ISR routines */
+/* RX channel done: every word of the burst is in */
+CY_ISR(SPID_Done_Handler)
+{
+    SPIDXfer *x = current;
+
+    if (x == NULL) return;
+    current = NULL;
+    x->state = SPID_DONE;
+    if (x->callback) x->callback(x);
+}
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,51 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 4
+ * DMA driven SPI master burst transfers
+ * 
+ * ========================================
+*/
+#ifndef SPIDMA_H
+#define SPIDMA_H
+
+#include <project.h>
+
+/* Longest burst in words, one TD moves at most 4095 bytes */
+#define SPID_MAX_WORDS  2047u
+
+/* Transfer states */
+#define SPID_IDLE       0
+#define SPID_BUSY       1
+#define SPID_DONE       2
+#define SPID_ERROR      3
+
+typedef struct SPIDXfer SPIDXfer;
+/* Completion callback, runs in the DMA done interrupt, or in
+ * SPID_Transfer when the burst is polled */
+typedef void (*SPIDCallback)(SPIDXfer *xfer);
+
+/* One full duplex burst of len words. txBuf may be NULL to clock out
+ * zeros, rxBuf may be NULL to drop what comes back. */
+struct SPIDXfer
+{
+    const uint16 *txBuf;
+    uint16 *rxBuf;
+    uint16 len;
+    SPIDCallback callback;
+    volatile uint8 state;
+};
+
+void SPID_Start(void);
+int SPID_Transfer(SPIDXfer *xfer);
+int SPID_Busy(void);
+void SPID_Benchmark(void (*out)(const char *s));
+
+#endif /* SPIDMA_H */
+
+/* [] END OF FILE */
@@ -16,13 +16,113 @@
 
 #include "project.h"
 #include "stdio.h"
+#include "trajectory.h"
+#include "cycles.h"
+#include "servomux.h"
+#include "servoscript.h"
+#include "servostream.h"
+#include "servopid.h"
+#include "systime.h"
+#include "coop.h"
+#include "idle.h"
+#include "timerwheel.h"
+#include "evq.h"
+#include "bitpin.h"
+
+/* Motion limits: 4000 us/s, 20000 us/s^2, 200000 us/s^3 of pulse width */
+#define SERVO_PROFILE   TRAJ_SCURVE
+#define SERVO_VMAX      TRAJ_VEL(4000)
+#define SERVO_AMAX      TRAJ_ACC(20000)
+#define SERVO_JMAX      TRAJ_JERK(200000)
+/* 1 measures the pulse jitter of every multiplexed channel into
+ * ServoMux_Jitter, at the cost of one interrupt per timer event */
+#define MUX_JITTER      1
+/* 1 closes the loop on the feedback pot, 0 trusts the servo.
+ * 1 needs ADC_Pot, Timer_PID and isr_pid in the schematic. */
+#define SERVO_CLOSED_LOOP   0
+#define PID_KP          PID_GAIN(0.3)
+#define PID_KI          PID_GAIN(0.02)
+#define PID_KD          PID_GAIN(1.0)
+#define PID_DSHIFT      3
+#define PID_OUT_MAX     300
+/* Pot counts with the servo at PID_CAL_LO and PID_CAL_HI, measure on the rig */
+#define POT_CAL_LO      1536
+#define POT_CAL_HI      2560
+/* Task periods: the UART stream and the multiplexed channels */
+#define STREAM_POLL_US  1000u
+#define MUX_POLL_US     5000u
+/* Presses closer than this to the last one are contact bounce, ms */
+#define BUTTON_HOLD_MS  100u
+/* 1 plays the whole step table as one DMA script per button press,
+ * 0 moves one step per press */
+#define BUTTON_SCRIPT   0
 
 CY_ISR_PROTO(ButtonISR_Handler);
 CY_ISR_PROTO(PWMISR_Handler);
+#if SERVO_CLOSED_LOOP
+CY_ISR_PROTO(PIDISR_Handler);
+#endif
+#if SERVO_STREAM_PRESENT
+static uint8 Stream_Frame(uint8 type, uint16 a, uint16 b);
+static void Stream(void);
+#endif
+#if SERVO_MUX_PRESENT
+static void Mux(void);
+#endif
+static void Events(void);
+static void Timers(void);
+static void Hold_Expire(Timer *t);
+static uint8 Step(void);
+static void Post(uint16 type, uint32 data);
+
+/* name, task */
+static CoopTask Tasks[] =
+{
+    { "Events", Events },
+    { "Timers", Timers },
+#if SERVO_STREAM_PRESENT
+    { "Stream", Stream },
+#endif
+#if SERVO_MUX_PRESENT
+    { "Mux", Mux },
+#endif
+};
+#define TASK_EVENTS     0
+#define TASK_COUNT (sizeof(Tasks)/sizeof(Tasks[0]))
+
+/* Events from the interrupts to the Events task, arg and data below */
+#define EV_BUTTON       1u  /* 0, SysTime ms of the press */
+#define EV_MOVING       2u  /* 0, width the servo left from */
+#define EV_ARRIVED      3u  /* 0, width the servo stopped at */
+
+#if BUTTON_SCRIPT && !SERVO_SCRIPT_PRESENT
+    #error "BUTTON_SCRIPT needs DMA_Script and isr_script in the schematic"
+#endif
+#if BUTTON_SCRIPT
+static void Script_Done(uint16 pos);
+/* Every step of the table with a 0.5 s hold, then back to neutral */
+static const ScriptWaypoint script[] =
+{
+    {500, 25}, {1000, 25}, {1500, 25}, {2000, 25}, {2400, 25}, {1500, 0}
+};
+#endif
 
 uint16 val = 1500;
-static volatile CYBIT button_flag = 0;
-static volatile CYBIT PWM_flag = 0;
+/* Interrupts to the Events task, nothing is coalesced */
+static EventQueue events;
+/* Servo motion, planned in main and stepped in the PWM ISR */
+static Traj servo;
+/* Last width written to PWM_Servo, from the trajectory or the stream */
+static volatile uint16 servoPos;
+/* Runs from a button press until the bouncing is over */
+static Timer hold = { .expire = Hold_Expire };
+#if SERVO_CLOSED_LOOP
+/* Position loop, stepped in the PID ISR */
+static PID pid;
+#endif
+/* Cycles spent in PWMISR_Handler and PIDISR_Handler, watch them in the debugger */
+volatile CycleStat PWMISR_Cycles;
+volatile CycleStat PIDISR_Cycles;
 
 
 int main(void)
@@ -30,6 +130,12 @@ int main(void)
     CyGlobalIntEnable; /* Enable global interrupts. */
     
     /* Initialization code */
+    Cycles_Start();
+    EvQ_Init(&events);
+    Traj_Init(&servo, val, SERVO_PROFILE, SERVO_VMAX, SERVO_AMAX, SERVO_JMAX);
+    servoPos = val;
+    SysTime_Start();
+    TimerWheel_Init(SysTime_Now());
     Clock_1MHz_Start();
     PWM_Servo_Start();
     
@@ -37,16 +143,109 @@ int main(void)
     
     isr_button_StartEx(ButtonISR_Handler);
     isr_PWM_StartEx(PWMISR_Handler);
+#if SERVO_MUX_PRESENT
+    /* Every multiplexed channel starts at neutral */
+    ServoMux_Start();
+    ServoMux_MeasureJitter(MUX_JITTER);
+#endif
+#if SERVO_STREAM_PRESENT
+    /* Targets streamed from the PC, see servostream.h for the frames */
+    UART_1_Start();
+    ServoStream_SetHandler(Stream_Frame);
+#endif
+#if SERVO_CLOSED_LOOP
+    /* The pot converts continuously, the PID ISR takes the latest result */
+    ServoPID_Init(&pid, val, PID_KP, PID_KI, PID_KD, PID_DSHIFT, PID_OUT_MAX);
+    ServoPID_Calibrate(&pid, POT_CAL_LO, POT_CAL_HI);
+    ADC_Pot_Start();
+    ADC_Pot_StartConvert();
+    Timer_PID_Start();
+    isr_pid_StartEx(PIDISR_Handler);
+#endif
     
+    Coop_Init(Tasks, TASK_COUNT);
+    /* The CPU waits for interrupts between tasks, the PWM and PID interrupts run on */
+    Idle_Start(0u, 0u);
     for(;;)
     {
-        if (button_flag) 
+        if (Coop_Run() == 0u) Idle_Run();
+    }
+}
+// Tasks
+#if SERVO_STREAM_PRESENT
+static void Stream(void)
+{
+    /* Queue the commands that came in over the UART */
+    ServoStream_Poll();
+    Coop_Sleep(STREAM_POLL_US);
+}
+#endif
+
+#if SERVO_MUX_PRESENT
+static void Mux(void)
+{
+    /* Last width sent to the multiplexed channels */
+    static uint16 muxval = 0;
+    
+    /* The multiplexed channels follow the servo, one table per frame at most */
+    if (muxval != servoPos)
+    {
+        uint16 pos = servoPos;
+        uint8 ch;
+        
+        for (ch = 0; ch < SERVO_MUX_CHANNELS; ch++) ServoMux_Set(ch, pos);
+        if (ServoMux_Commit() == 0) muxval = pos;
+    }
+    Coop_Sleep(MUX_POLL_US);
+}
+#endif
+
+static void Events(void)
+{
+    /* Moving from a step until it arrives, presses meanwhile wait */
+    static uint8 busy = 0;
+    static uint16 pending = 0;
+    Event ev;
+    
+    /* Every event in the order it was posted */
+    while (EvQ_Get(&events, &ev))
+    {
+        switch (ev.type)
         {
-            button_flag = 0;
-            LED1_Write(!LED1_Read());
-            CyDelay(100);
-        }   // notify of button interupt, no interference
+            case EV_BUTTON:
+                BitPin_Toggle(LED1);        // notify of button interupt
+                if (busy) pending++;
+                else busy = Step();
+                break;
+            case EV_MOVING:
+                busy = 1;
+                break;
+            case EV_ARRIVED:
+                /* The next press in line starts from here */
+                busy = 0;
+                if (pending)
+                {
+                    pending--;
+                    busy = Step();
+                }
+                break;
+            default:
+                break;
+        }
     }
+    Coop_Wait();
+}
+
+static void Timers(void)
+{
+    /* Expire the software timers, one SysTick tick at a time */
+    TimerWheel_Run(SysTime_Now());
+    Coop_Sleep(1000u);
+}
+
+static void Hold_Expire(Timer *t)
+{
+    (void) t;   // only its running matters
 }
 // Subroutine
 void nextpwm(void)
@@ -60,37 +259,158 @@ void nextpwm(void)
     return;
 } //steps for servo
 
+/* Start the next step, return 1 if the servo is moving to it */
+static uint8 Step(void)
+{
+    nextpwm();
+#if BUTTON_SCRIPT
+    /* Compute the whole motion now, the DMA plays it */
+    return ServoScript_Plan(&servo, Traj_Position(&servo), script, sizeof(script)/sizeof(script[0])) > 0
+        && ServoScript_Play(Script_Done) == 0;
+#else
+    /* Plan the move here, the ISR only steps it */
+    return Traj_Move(&servo, val) > 0;
+#endif
+}
+
+/* Queue an event for the Events task, from anywhere */
+static void Post(uint16 type, uint32 data)
+{
+    EvQ_Post(&events, type, 0u, data);
+    Coop_Signal(&Tasks[TASK_EVENTS]);
+}
+
+#if SERVO_STREAM_PRESENT
+/* PID frames on the servo stream
+ *  'A' relay(2) hyst(2)  start a relay auto-tune around the current position
+ *  'G' 0 0 0 0           use the gains found by the auto-tune
+ *  'T' 0 0 0 0           telemetry, answered with
+ *  't' setpoint(2) pv(2) out(2) integral(2) saturated(2) state(1) tu(2)
+ *      amp(2) kp(2) ki(2) kd(2) cycles(2)
+ *  'L' 0 0 0 0           main loop load since the last 'L', answered with
+ *  'l' idle permille(2) longest pass us(2) event latency us(2)
+ *      events dropped(2) deepest event queue(1) awake permille(2)
+ * Gains are Q8, the tuned ones once the auto-tune is done. 'A', 'G' and
+ * 'T' are only known with SERVO_CLOSED_LOOP. */
+static uint8 Stream_Frame(uint8 type, uint16 a, uint16 b)
+{
+    uint8 out[23];
+    int16 integ;
+    uint16 cycles;
+#if SERVO_CLOSED_LOOP
+    int32 kp = pid.kp, ki = pid.ki, kd = pid.kd;
+#endif
+    
+    switch (type)
+    {
+#if SERVO_CLOSED_LOOP
+        case 'A':
+            ServoPID_AutoTune(&pid, (int16)a, (int16)b);
+            return 0;
+        case 'G':
+            if (ServoPID_TuneGains(&pid, &kp, &ki, &kd) == 0) ServoPID_SetGains(&pid, kp, ki, kd);
+            return 0;
+        case 'T':
+            integ = (int16)(pid.integ >> PID_Q);
+            cycles = (uint16)PIDISR_Cycles.max;
+            ServoPID_TuneGains(&pid, &kp, &ki, &kd);
+            out[0] = LO8(pid.setpoint);     out[1] = HI8(pid.setpoint);
+            out[2] = LO8(pid.pv);           out[3] = HI8(pid.pv);
+            out[4] = LO8(pid.out);          out[5] = HI8(pid.out);
+            out[6] = LO8(integ);            out[7] = HI8(integ);
+            out[8] = LO8(pid.saturated);    out[9] = HI8(pid.saturated);
+            out[10] = pid.tune.state;
+            out[11] = LO8(pid.tune.tu);     out[12] = HI8(pid.tune.tu);
+            out[13] = LO8(pid.tune.amp);    out[14] = HI8(pid.tune.amp);
+            out[15] = LO8(kp);              out[16] = HI8(kp);
+            out[17] = LO8(ki);              out[18] = HI8(ki);
+            out[19] = LO8(kd);              out[20] = HI8(kd);
+            out[21] = LO8(cycles);          out[22] = HI8(cycles);
+            ServoStream_Send('t', out, sizeof(out));
+            return 0;
+#endif
+        case 'L':
+            integ = (int16)Coop_IdlePermille();
+            cycles = Coop_Load.passMax > 0xFFFFu ? 0xFFFFu : (uint16)Coop_Load.passMax;
+            out[0] = LO8(integ);            out[1] = HI8(integ);
+            out[2] = LO8(cycles);           out[3] = HI8(cycles);
+            cycles = Tasks[TASK_EVENTS].latencyMax > 0xFFFFu ? 0xFFFFu : (uint16)Tasks[TASK_EVENTS].latencyMax;
+            out[4] = LO8(cycles);           out[5] = HI8(cycles);
+            cycles = events.overflows > 0xFFFFu ? 0xFFFFu : (uint16)events.overflows;
+            out[6] = LO8(cycles);           out[7] = HI8(cycles);
+            out[8] = (uint8)events.maxDepth;
+            cycles = Idle_AwakePermille();
+            out[9] = LO8(cycles);           out[10] = HI8(cycles);
+            ServoStream_Send('l', out, 11u);
+            Coop_ResetLoad();
+            Idle_Start(0u, 0u);
+            return 0;
+        default:
+            return 1;
+    }
+}
+#endif
+
+#if BUTTON_SCRIPT
+// Script finished, runs in the DMA done interrupt
+static void Script_Done(uint16 pos)
+{
+    /* The trajectory carries on from where the script stopped */
+    Traj_Init(&servo, pos, SERVO_PROFILE, SERVO_VMAX, SERVO_AMAX, SERVO_JMAX);
+    Post(EV_ARRIVED, pos);
+}
+#endif
+
 // ISR Routine
 
 CY_ISR(ButtonISR_Handler)
 {
-    if (PWM_flag)   // PWM flag set => reached the destination
+    if (!TimerWheel_Armed(&hold))   // not bouncing, every press counts
     { 
-        nextpwm();
-        button_flag = 1;
+        TimerWheel_Start(&hold, BUTTON_HOLD_MS, 0u);
+        Post(EV_BUTTON, SysTime_Now());
     }
     Button_ClearInterrupt();
 } //Button ISR
 
 CY_ISR(PWMISR_Handler)
 {
-    static uint16 cval = 1500;
-    static uint16 pwmstep = 20;
+    uint32 start = Cycles_Now();
     
-    PWM_flag = 0;
-    // cval < val ? (cval += pwmstep) : (cval -= pwmstep);
-    if (cval < val) 
-    {
-        cval += pwmstep;
-        PWM_Servo_WriteCompare(cval);   //write to Compare register
-    }   // going forward 
-    else if (cval > val) 
-    {
-        cval -= pwmstep; 
-        PWM_Servo_WriteCompare(cval);   //write to Compare register
-    }   // going backward
-    else if (cval == val)
-        PWM_flag = 1;
+    /* Destination reached on the previous period */
+    static uint8 wasDone = 1;
+    uint16 pos;
+    uint8 stream, done;
+    
+    // one trajectory step per PWM period, streamed targets take over
+    pos = Traj_Step(&servo);
+    stream = ServoStream_Step(&pos);
+    // the trajectory carries on from where the stream let go
+    if (stream == STREAM_RELEASED) Traj_Init(&servo, pos, SERVO_PROFILE, SERVO_VMAX, SERVO_AMAX, SERVO_JMAX);
+#if SERVO_CLOSED_LOOP
+    ServoPID_SetPoint(&pid, pos);   // the PID ISR writes the compare
+#else
+    PWM_Servo_WriteCompare(pos);   //write to Compare register
+#endif
+    // report the servo starting and stopping, once per move
+    done = Traj_Done(&servo) && stream == STREAM_IDLE;
+    if (done != wasDone) Post(done ? EV_ARRIVED : EV_MOVING, pos);
+    wasDone = done;
+    servoPos = pos;
     PWM_Servo_ReadStatusRegister(); //reset interupt
+    Cycles_Record(PWMISR_Cycles, start);
 }   //PWM ISR
+
+#if SERVO_CLOSED_LOOP
+CY_ISR(PIDISR_Handler)
+{
+    uint32 start = Cycles_Now();
+    
+    // one control step on the latest pot reading, a playing script owns the compare
+    uint16 compare = ServoPID_Update(&pid, ADC_Pot_GetResult16());
+    if (!ServoScript_Busy()) PWM_Servo_WriteCompare(compare);
+    Timer_PID_ReadStatusRegister(); //reset interupt
+    Cycles_Record(PIDISR_Cycles, start);
+}   //PID ISR
+#endif
 /* [] END OF FILE */
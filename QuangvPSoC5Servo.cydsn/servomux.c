@@ -0,0 +1,248 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 2
+ * Time multiplexed servo PWM, 16 channels on one timer fed by DMA
+ * 
+ * Schematic: MuxTimer (16-bit UDB Timer on Clock_1MHz) requests
+ * DMA_MuxPer, DMA_MuxLo and DMA_MuxHi on its terminal count. They copy
+ * the next table entry to the timer period and to the ServoPinsLo and
+ * ServoPinsHi control registers that drive the servo pins. Each channel
+ * loops on its TD, so the frame repeats without the CPU. The nrq of
+ * DMA_MuxPer (end of frame) goes to isr_mux_frame. isr_mux_tc is on the
+ * terminal count and only runs while jitter is measured.
+ * 
+ * The frame: a fixed sync interval, then 8 slots of 2450 us. Channels
+ * k and k + 8 go high at the start of slot k and low after their width.
+ * A period written at an event is loaded at the next terminal count,
+ * so each entry holds the interval after the next event.
+ * 
+ * ========================================
+*/
+#include "servomux.h"
+#include "cycles.h"
+
+#if SERVO_MUX_PRESENT
+volatile uint32 ServoMux_Jitter[SERVO_MUX_CHANNELS];
+
+static ServoMuxTable table[2];
+static uint16 width[SERVO_MUX_CHANNELS];
+/* Table the DMA reads, and the relink state of a swap */
+static volatile uint8 active = 0;
+static volatile uint8 linkPending = 0;
+static volatile uint8 swapping = 0;
+static uint8 perChan, loChan, hiChan;
+static uint8 perTd[2], loTd[2], hiTd[2];
+/* Jitter measurement: pin state after the last event, rise time per channel */
+static uint16 lastPins;
+static uint32 rise[SERVO_MUX_CHANNELS];
+
+CY_ISR_PROTO(ServoMux_Frame_Handler);
+CY_ISR_PROTO(ServoMux_Tc_Handler);
+
+/* Point the TDs of table b at its entries, each TD loops on itself
+ * until the next swap */
+static void SetupTds(uint8 b)
+{
+    ServoMuxTable *t = &table[b];
+
+    CyDmaTdSetConfiguration(perTd[b], t->count * 2u, perTd[b], DMA_MuxPer__TD_TERMOUT_EN | TD_INC_SRC_ADR);
+    CyDmaTdSetAddress(perTd[b], LO16((uint32)t->period), LO16((uint32)MuxTimer_PERIOD_LSB_PTR));
+    CyDmaTdSetConfiguration(loTd[b], t->count, loTd[b], TD_INC_SRC_ADR);
+    CyDmaTdSetAddress(loTd[b], LO16((uint32)t->pinsLo), LO16((uint32)ServoPinsLo_Control_PTR));
+    CyDmaTdSetConfiguration(hiTd[b], t->count, hiTd[b], TD_INC_SRC_ADR);
+    CyDmaTdSetAddress(hiTd[b], LO16((uint32)t->pinsHi), LO16((uint32)ServoPinsHi_Control_PTR));
+}
+#endif
+
+/* Subprocesses */
+/* Build the event table for the given widths (us). Works on plain RAM,
+ * the DMA is not touched. */
+void ServoMux_Build(ServoMuxTable *t, const uint16 *w)
+{
+    uint16 lo, hi, wa, wb, start;
+    uint8 k, n = 0u, e;
+    uint16 pins = 0u;
+
+    /* Sync: every pin low */
+    t->at[n] = 0u;
+    t->pinsLo[n] = 0u;
+    t->pinsHi[n] = 0u;
+    n++;
+    for (k = 0u; k < SERVO_MUX_SLOTS; k++)
+    {
+        start = SERVO_MUX_SYNC_US + k * SERVO_MUX_SLOT_US;
+        wa = w[k];
+        wb = w[k + SERVO_MUX_SLOTS];
+        /* Rise of both channels of the slot */
+        pins = (uint16)((1u << k) | (1u << (k + SERVO_MUX_SLOTS)));
+        t->at[n] = start;
+        t->pinsLo[n] = (uint8)pins;
+        t->pinsHi[n] = (uint8)(pins >> 8);
+        n++;
+        /* Falling edges in time order, equal widths share one event */
+        lo = wa <= wb ? wa : wb;
+        hi = wa <= wb ? wb : wa;
+        pins &= (uint16)~((wa == lo ? 1u << k : 0u) | (wb == lo ? 1u << (k + SERVO_MUX_SLOTS) : 0u));
+        t->at[n] = start + lo;
+        t->pinsLo[n] = (uint8)pins;
+        t->pinsHi[n] = (uint8)(pins >> 8);
+        n++;
+        if (hi != lo)
+        {
+            pins = 0u;
+            t->at[n] = start + hi;
+            t->pinsLo[n] = 0u;
+            t->pinsHi[n] = 0u;
+            n++;
+        }
+    }
+    t->count = n;
+    for (k = 0u; k < SERVO_MUX_CHANNELS; k++) t->width[k] = w[k];
+    /* The period written at event e times the interval after event e + 1,
+     * the last one of the frame runs to the next sync */
+    for (e = 0u; e < n; e++)
+    {
+        uint8 a = (uint8)((e + 1u) % n), b = (uint8)((e + 2u) % n);
+        uint16 from = t->at[a];
+        uint16 to = b > a ? t->at[b] : (uint16)(SERVO_MUX_FRAME_US + t->at[b]);
+        t->period[e] = (uint16)(to - from - 1u);
+    }
+}
+#if SERVO_MUX_PRESENT
+/* Start the timer and the DMA with every channel at 1500 us */
+void ServoMux_Start(void)
+{
+    uint8 ch;
+
+    for (ch = 0u; ch < SERVO_MUX_CHANNELS; ch++) width[ch] = 1500u;
+    ServoMux_Build(&table[0], width);
+    table[1] = table[0];
+
+    perChan = DMA_MuxPer_DmaInitialize(2u, 1u, HI16(CYDEV_SRAM_BASE), HI16(CYDEV_PERIPH_BASE));
+    loChan = DMA_MuxLo_DmaInitialize(1u, 1u, HI16(CYDEV_SRAM_BASE), HI16(CYDEV_PERIPH_BASE));
+    hiChan = DMA_MuxHi_DmaInitialize(1u, 1u, HI16(CYDEV_SRAM_BASE), HI16(CYDEV_PERIPH_BASE));
+    for (ch = 0u; ch < 2u; ch++)
+    {
+        perTd[ch] = CyDmaTdAllocate();
+        loTd[ch] = CyDmaTdAllocate();
+        hiTd[ch] = CyDmaTdAllocate();
+        SetupTds(ch);
+    }
+    active = 0u;
+    CyDmaChSetInitialTd(perChan, perTd[0]);
+    CyDmaChSetInitialTd(loChan, loTd[0]);
+    CyDmaChSetInitialTd(hiChan, hiTd[0]);
+    CyDmaChEnable(perChan, 1u);
+    CyDmaChEnable(loChan, 1u);
+    CyDmaChEnable(hiChan, 1u);
+    isr_mux_frame_StartEx(ServoMux_Frame_Handler);
+    isr_mux_tc_StartEx(ServoMux_Tc_Handler);
+    isr_mux_tc_Disable();
+
+    /* The first terminal count is the sync event, the period loaded at it
+     * must be the sync interval */
+    MuxTimer_WritePeriod(SERVO_MUX_SYNC_US - 1u);
+    MuxTimer_Start();
+}
+/* Set the width of one channel, applied by the next ServoMux_Commit */
+void ServoMux_Set(uint8 ch, uint16 us)
+{
+    if (ch >= SERVO_MUX_CHANNELS) return;
+    if (us < SERVO_MUX_MIN_US) us = SERVO_MUX_MIN_US;
+    if (us > SERVO_MUX_MAX_US) us = SERVO_MUX_MAX_US;
+    width[ch] = us;
+}
+/* Rebuild the idle table with the widths set so far and switch to it at
+ * the end of a frame. Return 1 if the last switch is not done yet. */
+int ServoMux_Commit(void)
+{
+    uint8 idle;
+
+    if (linkPending || swapping) return 1;
+    idle = active ^ 1u;
+    ServoMux_Build(&table[idle], width);
+    SetupTds(idle);
+    linkPending = 1u;
+    return 0;
+}
+/* Jitter measurement, adds an interrupt per timer event while enabled */
+void ServoMux_MeasureJitter(uint8 enable)
+{
+    uint8 ch;
+
+    if (enable)
+    {
+        for (ch = 0u; ch < SERVO_MUX_CHANNELS; ch++) ServoMux_Jitter[ch] = 0u;
+        Cycles_Enable();
+        lastPins = 0u;
+        isr_mux_tc_Enable();
+    }
+    else isr_mux_tc_Disable();
+}
+
+/* ISR routines */
+/* End of frame: the last event of the table has been copied. Link the
+ * running TDs to the new table, then find out from the channel which
+ * table it runs, the PHUB may load the next TD now or at the next request. */
+CY_ISR(ServoMux_Frame_Handler)
+{
+    uint8 old = active, idle = active ^ 1u;
+    ServoMuxTable *t = &table[old];
+    uint8 td, state;
+
+    if (linkPending)
+    {
+        CyDmaTdSetConfiguration(perTd[old], t->count * 2u, perTd[idle], DMA_MuxPer__TD_TERMOUT_EN | TD_INC_SRC_ADR);
+        CyDmaTdSetConfiguration(loTd[old], t->count, loTd[idle], TD_INC_SRC_ADR);
+        CyDmaTdSetConfiguration(hiTd[old], t->count, hiTd[idle], TD_INC_SRC_ADR);
+        linkPending = 0u;
+        swapping = 1u;
+    }
+    else if (swapping)
+    {
+        CyDmaChStatus(perChan, &td, &state);
+        if (td == perTd[idle])
+        {
+            active = idle;
+            swapping = 0u;
+        }
+    }
+}
+/* Terminal count while measuring. The DMA has written the pins of this
+ * event, a pin that went high starts a pulse and a pin that went low
+ * ends it. Both edges see the same interrupt latency, the difference to
+ * the planned width is the jitter of that channel. */
+CY_ISR(ServoMux_Tc_Handler)
+{
+    uint32 now = Cycles_Now();
+    uint16 pins = (uint16)(ServoPinsLo_Read() | ((uint16)ServoPinsHi_Read() << 8));
+    uint16 up = pins & (uint16)~lastPins;
+    uint16 down = lastPins & (uint16)~pins;
+    uint32 plan, diff;
+    uint8 ch;
+
+    lastPins = pins;
+    MuxTimer_ReadStatusRegister();
+    for (ch = 0u; ch < SERVO_MUX_CHANNELS && (up | down); ch++)
+    {
+        if (up & (1u << ch)) rise[ch] = now;
+        else if ((down & (1u << ch)) && !swapping)
+        {
+            plan = (uint32)table[active].width[ch] * cydelay_freq_mhz;
+            diff = now - rise[ch];
+            diff = diff > plan ? diff - plan : plan - diff;
+            if (diff > ServoMux_Jitter[ch]) ServoMux_Jitter[ch] = diff;
+        }
+        up &= (uint16)~(1u << ch);
+        down &= (uint16)~(1u << ch);
+    }
+}
+#endif /* SERVO_MUX_PRESENT */
+
+/* [] END OF FILE */
@@ -0,0 +1,66 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 2
+ * Time multiplexed servo PWM, 16 channels on one timer fed by DMA
+ * 
+ * ========================================
+*/
+#ifndef SERVOMUX_H
+#define SERVOMUX_H
+
+#include <project.h>
+
+/* The driver needs MuxTimer, DMA_MuxPer/Lo/Hi, ServoPinsLo/Hi and
+ * isr_mux_frame/isr_mux_tc in the schematic. Without them only
+ * ServoMux_Build is there. */
+#if defined(MuxTimer_PERIOD_LSB_PTR)
+    #define SERVO_MUX_PRESENT   1
+#else
+    #define SERVO_MUX_PRESENT   0
+#endif
+
+/* Two banks of 8 pins, channel k and k + 8 share slot k */
+#define SERVO_MUX_CHANNELS  16
+#define SERVO_MUX_SLOTS     8
+/* Frame and slot timing in us (MuxTimer runs on Clock_1MHz) */
+#define SERVO_MUX_FRAME_US  20000u
+#define SERVO_MUX_SYNC_US   50u
+#define SERVO_MUX_SLOT_US   2450u
+#define SERVO_MUX_MIN_US    500u
+#define SERVO_MUX_MAX_US    2400u
+/* Sync, slot start and two falling edges per slot */
+#define SERVO_MUX_EVENTS    (1 + 3 * SERVO_MUX_SLOTS)
+
+/* Event table: pin state after each timer event and the period the
+ * DMA writes at that event. Two of them, one drives the pins while the
+ * other is rebuilt. */
+typedef struct
+{
+    uint16 period[SERVO_MUX_EVENTS];
+    uint8 pinsLo[SERVO_MUX_EVENTS];
+    uint8 pinsHi[SERVO_MUX_EVENTS];
+    uint16 at[SERVO_MUX_EVENTS];    /* event time in the frame, us */
+    uint16 width[SERVO_MUX_CHANNELS];
+    uint8 count;
+} ServoMuxTable;
+
+void ServoMux_Build(ServoMuxTable *t, const uint16 *width);
+#if SERVO_MUX_PRESENT
+/* Largest deviation of a pulse from its planned width, CPU cycles */
+extern volatile uint32 ServoMux_Jitter[SERVO_MUX_CHANNELS];
+
+void ServoMux_Start(void);
+void ServoMux_Set(uint8 ch, uint16 us);
+int ServoMux_Commit(void);
+void ServoMux_MeasureJitter(uint8 enable);
+#endif
+
+#endif /* SERVOMUX_H */
+
+/* [] END OF FILE */
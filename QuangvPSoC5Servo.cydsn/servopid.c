@@ -0,0 +1,192 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * PSoC fundamentals Exercise 2
+ * Fixed-point PID position loop on the feedback pot, with relay auto-tune
+ *
+ * The servo keeps its own loop, so the setpoint goes out as is and the
+ * PID only adds a correction for what the pot says is left over: load,
+ * linkage play and the servo's own calibration. ServoPID_Update has no
+ * loops and no divisions, every tick takes the same few multiplies.
+ *
+ * ========================================
+*/
+#include <project.h>
+#include "servopid.h"
+
+/* Oscillations averaged by the relay test after one to settle, a power of two */
+#define PID_TUNE_SHIFT      2
+#define PID_TUNE_AVG        (1u << PID_TUNE_SHIFT)
+
+/* Subprocesses */
+void ServoPID_Init(PID *p, uint16 setpoint, int32 kp, int32 ki, int32 kd, uint8 dShift, int16 outMax)
+{
+    p->kp = kp;
+    p->ki = ki;
+    p->kd = kd;
+    p->dShift = dShift;
+    p->outMax = outMax;
+    /* Until calibrated: 12 bit pot over the full 500..2500 travel */
+    ServoPID_Calibrate(p, 1024, 3072);
+    p->setpoint = setpoint;
+    p->integ = 0;
+    p->dFilt = 0;
+    p->pv = (int16)setpoint;
+    p->err = 0;
+    p->out = 0;
+    p->saturated = 0u;
+    p->tune.state = PID_TUNE_OFF;
+}
+/* Pot counts read with the servo held at PID_CAL_LO and PID_CAL_HI */
+void ServoPID_Calibrate(PID *p, int16 countsLo, int16 countsHi)
+{
+    int32 span = (int32)countsHi - countsLo;
+
+    if (span == 0) return;
+    p->potLo = countsLo;
+    p->potGain = ((int32)(PID_CAL_HI - PID_CAL_LO) << 16) / span;
+}
+/* One relay step of the auto-tune, returns the correction */
+static int16 Tune_Step(PID *p, int16 e)
+{
+    PIDTune *t = &p->tune;
+
+    t->ticks++;
+    if (e > t->emax) t->emax = e;
+    if (e < t->emin) t->emin = e;
+    if (!t->high && e > t->hyst)
+    {
+        /* Below the setpoint again: one oscillation since the last time */
+        t->high = 1u;
+        if (t->cycles >= 2u)
+        {
+            t->tuSum += t->ticks;
+            t->ampSum += (t->emax - t->emin) >> 1;
+        }
+        if (++t->cycles == PID_TUNE_AVG + 2u)
+        {
+            t->tu = (uint16)(t->tuSum >> PID_TUNE_SHIFT);
+            t->amp = (int16)(t->ampSum >> PID_TUNE_SHIFT);
+            t->state = PID_TUNE_DONE;
+            p->integ = 0;
+            return 0;
+        }
+        t->ticks = 0u;
+        t->emax = e;
+        t->emin = e;
+    }
+    else if (t->high && e < -t->hyst)
+    {
+        t->high = 0u;
+    }
+    else if (t->ticks > PID_TUNE_TIMEOUT)
+    {
+        /* No oscillation, nothing to learn */
+        t->tu = 0u;
+        t->amp = 0;
+        t->state = PID_TUNE_DONE;
+        return 0;
+    }
+    return t->high ? t->relay : -t->relay;
+}
+/* One control tick, called from the Timer_PID interrupt with the latest
+ * pot reading. Return the compare value for PWM_Servo. */
+uint16 ServoPID_Update(PID *p, int16 counts)
+{
+    int32 sp = p->setpoint;
+    int32 pv = PID_CAL_LO + ((((int32)counts - p->potLo) * p->potGain) >> 16);
+    int32 e = sp - pv;
+    int32 hi = PID_MAX_WIDTH - sp, lo = PID_MIN_WIDTH - sp;
+    int32 out;
+
+    if (hi > p->outMax) hi = p->outMax;
+    if (lo < -p->outMax) lo = -p->outMax;
+    /* Derivative on the measurement, so setpoint steps do not kick,
+     * low-pass filtered against pot noise */
+    p->dFilt += ((pv - p->pv) * -p->kd - p->dFilt) >> p->dShift;
+    p->pv = (int16)pv;
+    p->err = (int16)e;
+
+    if (p->tune.state == PID_TUNE_RUNNING)
+    {
+        out = Tune_Step(p, (int16)e);
+    }
+    else
+    {
+        out = (p->kp * e + p->integ + p->dFilt) >> PID_Q;
+        if (out >= hi) out = hi;
+        else if (out <= lo) out = lo;
+        /* Anti-windup: stop integrating towards a limit already reached */
+        if ((out == hi && e > 0) || (out == lo && e < 0))
+        {
+            p->saturated++;
+        }
+        /* Far from the setpoint the integral may only shrink */
+        else if ((e < PID_I_ZONE && e > -PID_I_ZONE) || (e > 0) != (p->integ > 0))
+        {
+            p->integ += p->ki * e;
+            if (p->integ > ((int32)p->outMax << PID_Q)) p->integ = (int32)p->outMax << PID_Q;
+            if (p->integ < -((int32)p->outMax << PID_Q)) p->integ = -((int32)p->outMax << PID_Q);
+        }
+    }
+    if (out > hi) out = hi;
+    if (out < lo) out = lo;
+    p->out = (int16)out;
+    return (uint16)(sp + out);
+}
+/* Start a relay test around the current setpoint. The output swings by
+ * relay, switching when the error leaves the hyst band. */
+void ServoPID_AutoTune(PID *p, int16 relay, int16 hyst)
+{
+    PIDTune *t = &p->tune;
+    uint8 intState = CyEnterCriticalSection();
+
+    t->relay = relay;
+    t->hyst = hyst;
+    t->high = p->err > 0;
+    t->cycles = 0u;
+    t->ticks = 0u;
+    t->emax = p->err;
+    t->emin = p->err;
+    t->tuSum = 0u;
+    t->ampSum = 0;
+    t->tu = 0u;
+    t->amp = 0;
+    t->state = PID_TUNE_RUNNING;
+    CyExitCriticalSection(intState);
+}
+/* Gains from the last relay test, Ziegler-Nichols "no overshoot" rule:
+ * Kp = 0.2 Ku, Ti = Tu / 2, Td = Tu / 3 with Ku = 4 relay / (pi amp).
+ * Return 1 if there is no usable test. */
+int ServoPID_TuneGains(const PID *p, int32 *kp, int32 *ki, int32 *kd)
+{
+    const PIDTune *t = &p->tune;
+    int32 ku;
+
+    if (t->state != PID_TUNE_DONE || t->tu == 0u || t->amp <= 0) return 1;
+    /* Q8, pi as 355/113 */
+    ku = ((int32)4 * t->relay * 113 << PID_Q) / ((int32)355 * t->amp);
+    *kp = ku / 5;
+    *ki = ku * 2 / (5 * (int32)t->tu);
+    *kd = ku * (int32)t->tu / 15;
+    return 0;
+}
+void ServoPID_SetGains(PID *p, int32 kp, int32 ki, int32 kd)
+{
+    uint8 intState = CyEnterCriticalSection();
+
+    p->kp = kp;
+    p->ki = ki;
+    p->kd = kd;
+    p->integ = 0;
+    p->dFilt = 0;
+    p->tune.state = PID_TUNE_OFF;
+    CyExitCriticalSection(intState);
+}
+
+/* [] END OF FILE */
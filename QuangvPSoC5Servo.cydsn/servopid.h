@@ -0,0 +1,95 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * PSoC fundamentals Exercise 2
+ * Fixed-point PID position loop on the feedback pot, with relay auto-tune
+ *
+ * ========================================
+*/
+#ifndef SERVOPID_H
+#define SERVOPID_H
+
+#include "cytypes.h"
+
+/* Control rate, Timer_PID interrupt */
+#define PID_RATE_HZ         250
+/* Gains are Q8, per tick for the integral and derivative terms */
+#define PID_Q               8
+#define PID_GAIN(g)         ((int32)((g) * 256.0))
+/* Pulse widths the output never leaves */
+#define PID_MIN_WIDTH       500
+#define PID_MAX_WIDTH       2500
+/* The integral only grows this close to the setpoint, so it does not
+ * wind up while the servo slews at its own speed limit */
+#define PID_I_ZONE          50
+/* Widths the pot is calibrated at */
+#define PID_CAL_LO          1000
+#define PID_CAL_HI          2000
+
+/* Auto-tune states */
+#define PID_TUNE_OFF        0u
+#define PID_TUNE_RUNNING    1u
+#define PID_TUNE_DONE       2u
+/* Give up after this many ticks without a full oscillation */
+#define PID_TUNE_TIMEOUT    (4 * PID_RATE_HZ)
+
+/* Relay test: the output swings by relay around the setpoint and the
+ * loop settles into an oscillation of period tu and amplitude amp */
+typedef struct
+{
+    uint8 state;
+    int16 relay;            // relay amplitude, compare counts
+    int16 hyst;             // switching band around zero error
+    uint8 high;             // relay output is high
+    uint8 cycles;           // oscillations seen
+    uint16 ticks;           // ticks since the last switch to high
+    int16 emax, emin;       // error extremes of this oscillation
+    uint32 tuSum;
+    int32 ampSum;
+    /* Results, valid in PID_TUNE_DONE */
+    uint16 tu;              // ticks
+    int16 amp;              // compare counts
+} PIDTune;
+
+typedef struct
+{
+    /* Gains, Q8 */
+    int32 kp;
+    int32 ki;
+    int32 kd;
+    /* Derivative filter, each tick moves 1/2^dShift of the way */
+    uint8 dShift;
+    /* Largest correction around the setpoint */
+    int16 outMax;
+    /* Pot counts at PID_CAL_LO and Q16 widths per count */
+    int32 potLo;
+    int32 potGain;
+    /* Loop state */
+    volatile uint16 setpoint;
+    int32 integ;            // Q8
+    int32 dFilt;            // Q8
+    int16 pv;               // last measured width
+    int16 err;
+    int16 out;              // last correction
+    uint32 saturated;       // ticks spent at the correction limit
+    PIDTune tune;
+} PID;
+
+void ServoPID_Init(PID *p, uint16 setpoint, int32 kp, int32 ki, int32 kd, uint8 dShift, int16 outMax);
+void ServoPID_Calibrate(PID *p, int16 countsLo, int16 countsHi);
+uint16 ServoPID_Update(PID *p, int16 counts);
+void ServoPID_AutoTune(PID *p, int16 relay, int16 hyst);
+int ServoPID_TuneGains(const PID *p, int32 *kp, int32 *ki, int32 *kd);
+void ServoPID_SetGains(PID *p, int32 kp, int32 ki, int32 kd);
+
+/* New position to hold, safe to call from any interrupt */
+#define ServoPID_SetPoint(p, sp)    ((p)->setpoint = (sp))
+
+#endif /* SERVOPID_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,120 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 2
+ * Scripted servo motion, precomputed compare values played by DMA
+ * 
+ * Schematic: the PWM_Servo terminal count requests DMA_Script, which
+ * copies the next table entry to the compare register. The nrq of
+ * DMA_Script goes to isr_script. While a script plays isr_PWM is off,
+ * the CPU only hears about it at the end.
+ * 
+ * ========================================
+*/
+#include "servoscript.h"
+
+static uint16 points[SCRIPT_MAX_POINTS];
+static uint16 pointCount = 0u;
+static volatile uint8 playing = 0u;
+#if SERVO_SCRIPT_PRESENT
+static uint8 chan = CY_DMA_INVALID_CHANNEL;
+static uint8 td[SCRIPT_MAX_TDS];
+static void (*onDone)(uint16 pos);
+
+CY_ISR_PROTO(ServoScript_Done_Handler);
+#endif
+
+/* Subprocesses */
+/* Run the trajectory generator through the waypoints ahead of time and
+ * keep every compare value. The motion starts at from with the limits of
+ * servo, servo itself is not touched. Return the number of PWM periods,
+ * or -1 if the script does not fit in the table. */
+int ServoScript_Plan(const Traj *servo, uint16 from, const ScriptWaypoint *wp, uint8 count)
+{
+    Traj t;
+    uint16 n = 0u, k;
+    uint8 i;
+
+    if (playing) return -1;
+    Traj_Init(&t, from, servo->profile, servo->vmax, servo->amax, servo->jmax);
+    for (i = 0u; i < count; i++)
+    {
+        Traj_Move(&t, wp[i].pos);
+        while (!Traj_Done(&t))
+        {
+            if (n >= SCRIPT_MAX_POINTS) return -1;
+            points[n++] = Traj_Step(&t);
+        }
+        for (k = 0u; k < wp[i].dwell; k++)
+        {
+            if (n >= SCRIPT_MAX_POINTS) return -1;
+            points[n++] = wp[i].pos;
+        }
+    }
+    pointCount = n;
+    return n;
+}
+/* Start the planned script on the next PWM periods and stop the PWM
+ * interrupt. done runs in the interrupt after the last value with the
+ * final position. Return 1 if nothing is planned or a script plays,
+ * or if there is no DMA_Script to play it. */
+int ServoScript_Play(void (*done)(uint16 pos))
+{
+#if SERVO_SCRIPT_PRESENT
+    uint16 left = pointCount, len;
+    const uint16 *src = points;
+    uint8 i, n;
+
+    if (playing || pointCount == 0u) return 1;
+    if (chan == CY_DMA_INVALID_CHANNEL)
+    {
+        chan = DMA_Script_DmaInitialize(2u, 1u, HI16(CYDEV_SRAM_BASE), HI16(CYDEV_PERIPH_BASE));
+        for (i = 0u; i < SCRIPT_MAX_TDS; i++) td[i] = CyDmaTdAllocate();
+        isr_script_StartEx(ServoScript_Done_Handler);
+    }
+    /* Chain as many TDs as the table needs, only the last one signals */
+    for (n = 0u; left; n++)
+    {
+        len = left > SCRIPT_TD_POINTS ? SCRIPT_TD_POINTS : left;
+        left -= len;
+        CyDmaTdSetConfiguration(td[n], len * 2u, left ? td[n + 1u] : CY_DMA_DISABLE_TD,
+                                TD_INC_SRC_ADR | (left ? 0u : DMA_Script__TD_TERMOUT_EN));
+        CyDmaTdSetAddress(td[n], LO16((uint32)src), LO16((uint32)PWM_Servo_COMPARE1_LSB_PTR));
+        src += len;
+    }
+    onDone = done;
+    playing = 1u;
+    isr_PWM_Disable();
+    CyDmaChSetInitialTd(chan, td[0]);
+    CyDmaChEnable(chan, 1u);
+    return 0;
+#else
+    (void) done;
+    return 1;
+#endif
+}
+/* Return 1 while a script plays */
+int ServoScript_Busy(void)
+{
+    return playing;
+}
+
+#if SERVO_SCRIPT_PRESENT
+/* ISR routines */
+/* Last compare value written: hand the servo back to isr_PWM */
+CY_ISR(ServoScript_Done_Handler)
+{
+    playing = 0u;
+    PWM_Servo_ReadStatusRegister();
+    isr_PWM_ClearPending();
+    isr_PWM_Enable();
+    if (onDone) onDone(points[pointCount - 1u]);
+}
+#endif
+
+/* [] END OF FILE */
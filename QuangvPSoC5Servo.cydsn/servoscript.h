@@ -0,0 +1,47 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 2
+ * Scripted servo motion, precomputed compare values played by DMA
+ * 
+ * ========================================
+*/
+#ifndef SERVOSCRIPT_H
+#define SERVOSCRIPT_H
+
+#include <project.h>
+#include "trajectory.h"
+
+/* Playing needs DMA_Script and isr_script in the schematic. Without them
+ * a script can be planned but not played, and nothing is ever busy. */
+#if defined(DMA_Script__TD_TERMOUT_EN)
+    #define SERVO_SCRIPT_PRESENT    1
+#else
+    #define SERVO_SCRIPT_PRESENT    0
+#endif
+
+/* Compare values in the table, one per PWM period (20 ms), 1024 = 20 s */
+#define SCRIPT_MAX_POINTS   1024u
+/* Longest TD: 4095 bytes, whole compare values */
+#define SCRIPT_TD_POINTS    2047u
+#define SCRIPT_MAX_TDS      ((SCRIPT_MAX_POINTS + SCRIPT_TD_POINTS - 1u) / SCRIPT_TD_POINTS)
+
+/* One stop of the script: move to pos, then hold it for dwell periods */
+typedef struct
+{
+    uint16 pos;
+    uint16 dwell;
+} ScriptWaypoint;
+
+int ServoScript_Plan(const Traj *servo, uint16 from, const ScriptWaypoint *wp, uint8 count);
+int ServoScript_Play(void (*done)(uint16 pos));
+int ServoScript_Busy(void);
+
+#endif /* SERVOSCRIPT_H */
+
+/* [] END OF FILE */
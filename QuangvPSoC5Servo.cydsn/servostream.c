@@ -0,0 +1,260 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * PSoC fundamentals Exercise 2
+ * Servo command stream over UART
+ *
+ * The main loop parses frames from UART_1 into a ring of timestamped
+ * targets, the PWM interrupt takes them out one segment at a time.
+ * Only main writes head and only the interrupt writes tail, so neither
+ * side has to lock the other out.
+ *
+ * ========================================
+*/
+#include "servostream.h"
+
+#define STREAM_MASK     (STREAM_QUEUE_SIZE - 1u)
+#define STREAM_Q        16
+
+typedef struct
+{
+    uint8 type;
+    uint16 target;
+    uint16 at;
+} StreamCmd;
+
+static StreamCmd queue[STREAM_QUEUE_SIZE];
+static volatile uint8 head = 0u;        // written by main
+static volatile uint8 tail = 0u;        // written by the PWM interrupt
+
+/* Interrupt side */
+static volatile uint8 driving = 0u;
+static uint8 starved = 0u;
+static uint16 now;                      // stream time, PWM periods
+static int32 posQ, stepQ, goalQ;        // position, step and target, Q16
+static uint16 left = 0u;                // periods to the current target
+static volatile uint16 underruns = 0u, late = 0u;
+
+/* Main side */
+static uint16 overflows = 0u, errors = 0u;
+static StreamHandler extra = 0;
+#if SERVO_STREAM_PRESENT
+static uint8 frame[STREAM_FRAME_LEN];
+static uint8 frameLen = 0u;
+#endif
+
+/* Subprocesses */
+#if SERVO_STREAM_PRESENT
+static void Stream_Push(uint8 type, uint16 target, uint16 at)
+{
+    uint8 h = head;
+
+    if ((uint8)(h - tail) >= STREAM_QUEUE_SIZE)
+    {
+        overflows++;
+        return;
+    }
+    queue[h & STREAM_MASK].type = type;
+    queue[h & STREAM_MASK].target = target;
+    queue[h & STREAM_MASK].at = at;
+    /* The entry is complete before the interrupt can see it: queue is
+     * not volatile, so the stores may not move past head without this */
+    __DMB();
+    head = h + 1u;
+}
+
+static void Stream_Reply(void)
+{
+    StreamStatus s;
+    uint8 out[9];
+
+    ServoStream_Status(&s);
+    out[0] = s.depth;
+    out[1] = LO8(s.underruns);
+    out[2] = HI8(s.underruns);
+    out[3] = LO8(s.late);
+    out[4] = HI8(s.late);
+    out[5] = LO8(s.overflows);
+    out[6] = HI8(s.overflows);
+    out[7] = LO8(s.errors);
+    out[8] = HI8(s.errors);
+    ServoStream_Send('q', out, sizeof(out));
+}
+
+static void Stream_Frame(void)
+{
+    uint8 i, sum = 0u;
+    uint16 a = (uint16)frame[2] | ((uint16)frame[3] << 8);
+    uint16 b = (uint16)frame[4] | ((uint16)frame[5] << 8);
+
+    for (i = 1u; i < STREAM_FRAME_LEN - 1u; i++) sum ^= frame[i];
+    if (sum != frame[STREAM_FRAME_LEN - 1u])
+    {
+        errors++;
+        return;
+    }
+    switch (frame[1])
+    {
+        case 'P':
+            /* The interrupt shifts the target into Q16, keep it a pulse width */
+            if (a < STREAM_MIN_US || a > STREAM_MAX_US)
+            {
+                errors++;
+                a = a < STREAM_MIN_US ? STREAM_MIN_US : STREAM_MAX_US;
+            }
+            Stream_Push('P', a, b);
+            break;
+        case 'S':
+            Stream_Push('S', 0u, a);
+            break;
+        case 'X':
+            Stream_Push('X', 0u, 0u);
+            break;
+        case 'Q':
+            Stream_Reply();
+            break;
+        default:
+            if (extra == 0 || extra(frame[1], a, b)) errors++;
+            break;
+    }
+}
+#endif
+
+void ServoStream_SetHandler(StreamHandler handler)
+{
+    extra = handler;
+}
+/* Send one frame to the PC: sync, type, payload and checksum */
+void ServoStream_Send(uint8 type, const uint8 *payload, uint8 len)
+{
+#if SERVO_STREAM_PRESENT
+    uint8 i, sum = type;
+
+    for (i = 0u; i < len; i++) sum ^= payload[i];
+    UART_1_PutChar(STREAM_SYNC);
+    UART_1_PutChar(type);
+    UART_1_PutArray(payload, len);
+    UART_1_PutChar(sum);
+#else
+    (void) type;
+    (void) payload;
+    (void) len;
+#endif
+}
+
+/* Read every waiting UART byte and queue the complete frames.
+ * Call from the main loop often enough to keep the UART from overflowing. */
+void ServoStream_Poll(void)
+{
+#if SERVO_STREAM_PRESENT
+    uint8 c;
+
+    while (UART_1_GetRxBufferSize())
+    {
+        c = UART_1_ReadRxData();
+        /* Wait for the start of a frame */
+        if (frameLen == 0u && c != STREAM_SYNC) continue;
+        frame[frameLen++] = c;
+        if (frameLen == STREAM_FRAME_LEN)
+        {
+            Stream_Frame();
+            frameLen = 0u;
+        }
+    }
+#endif
+}
+
+/* One PWM period of the stream, called from the PWM interrupt.
+ * pos holds the position the servo would have without the stream and
+ * is replaced while the stream drives it. Targets are reached at their
+ * time stamp, the next command starts in the period after, so a full
+ * queue moves the servo without a pause. */
+uint8 ServoStream_Step(uint16 *pos)
+{
+    StreamCmd *c;
+    int16 ticks;
+    uint8 t = tail;
+
+    if (!driving && t == head) return STREAM_IDLE;
+    if (!driving)
+    {
+        /* The first command takes over from wherever the servo is */
+        driving = 1u;
+        starved = 0u;
+        now = 0u;
+        posQ = (int32)*pos << STREAM_Q;
+        left = 0u;
+    }
+    else now++;
+
+    /* Segment finished: start the next one in the same period */
+    while (left == 0u && t != head)
+    {
+        c = &queue[t & STREAM_MASK];
+        t++;
+        starved = 0u;
+        if (c->type == 'X')
+        {
+            tail = t;
+            driving = 0u;
+            *pos = (uint16)(posQ >> STREAM_Q);
+            return STREAM_RELEASED;
+        }
+        if (c->type == 'S')
+        {
+            now = c->at;
+            continue;
+        }
+        /* Periods up to and including the one at the time stamp */
+        ticks = (int16)(c->at - now) + 1;
+        if (ticks <= 0)
+        {
+            /* Too late to move smoothly, go straight there */
+            late++;
+            posQ = (int32)c->target << STREAM_Q;
+            continue;
+        }
+        left = (uint16)ticks;
+        goalQ = (int32)c->target << STREAM_Q;
+        stepQ = (goalQ - posQ) / ticks;
+    }
+    tail = t;
+
+    if (left)
+    {
+        /* The last period lands exactly on the target */
+        if (--left == 0u)
+            posQ = goalQ;
+        else
+            posQ += stepQ;
+    }
+    else if (!starved)
+    {
+        /* Nothing to do next, hold the position until more arrives */
+        starved = 1u;
+        underruns++;
+    }
+    *pos = (uint16)(posQ >> STREAM_Q);
+    return STREAM_DRIVING;
+}
+
+uint8 ServoStream_Driving(void)
+{
+    return driving;
+}
+
+void ServoStream_Status(StreamStatus *s)
+{
+    s->depth = (uint8)(head - tail);
+    s->underruns = underruns;
+    s->late = late;
+    s->overflows = overflows;
+    s->errors = errors;
+}
+
+/* [] END OF FILE */
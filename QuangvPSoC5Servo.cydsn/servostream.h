@@ -0,0 +1,72 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *
+ * PSoC fundamentals Exercise 2
+ * Servo command stream over UART
+ *
+ * ========================================
+*/
+#ifndef SERVOSTREAM_H
+#define SERVOSTREAM_H
+
+#include <project.h>
+
+/* The stream comes in on UART_1. Without it nothing is ever queued and
+ * ServoStream_Step leaves the servo alone. */
+#if defined(UART_1_RX_ENABLED)
+    #define SERVO_STREAM_PRESENT    1
+#else
+    #define SERVO_STREAM_PRESENT    0
+#endif
+
+/* Commands waiting for the PWM interrupt, power of two up to 128 */
+#define STREAM_QUEUE_SIZE   32u
+/* 'P' targets are held to the pulse widths of the step table, us */
+#define STREAM_MIN_US       500u
+#define STREAM_MAX_US       2400u
+
+/* Frames, all start with STREAM_SYNC and end with the XOR of the bytes
+ * between the sync and the checksum.
+ *  'P' target(2) at(2)  reach target us at stream time at (PWM periods),
+ *                       a target out of range is clamped and counted as an error
+ *  'S' at(2) 0 0        set the stream time to at
+ *  'X' 0 0 0 0          give the servo back after the queued moves
+ *  'Q' 0 0 0 0          status, answered with
+ *  'q' depth(1) underruns(2) late(2) overflows(2) errors(2)
+ * Values are little endian. Other types go to the handler given to
+ * ServoStream_SetHandler. */
+#define STREAM_SYNC         0xA5u
+#define STREAM_FRAME_LEN    7u
+
+/* ServoStream_Step results */
+#define STREAM_IDLE         0u  // the stream does not drive the servo
+#define STREAM_DRIVING      1u  // pos comes from the stream
+#define STREAM_RELEASED     2u  // last tick of the stream, pos is where it stopped
+
+typedef struct
+{
+    uint8 depth;            // commands in the queue
+    uint16 underruns;       // times the queue ran dry while driving
+    uint16 late;            // targets whose time had already passed
+    uint16 overflows;       // commands dropped on a full queue
+    uint16 errors;          // frames with a bad checksum, type or target
+} StreamStatus;
+
+/* Takes a frame the stream does not know, returns 1 if it is not known either */
+typedef uint8 (*StreamHandler)(uint8 type, uint16 a, uint16 b);
+
+void ServoStream_SetHandler(StreamHandler handler);
+void ServoStream_Send(uint8 type, const uint8 *payload, uint8 len);
+void ServoStream_Poll(void);
+uint8 ServoStream_Step(uint16 *pos);
+uint8 ServoStream_Driving(void);
+void ServoStream_Status(StreamStatus *s);
+
+#endif /* SERVOSTREAM_H */
+
+/* [] END OF FILE */
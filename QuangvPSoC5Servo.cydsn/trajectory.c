@@ -0,0 +1,239 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 2
+ * Fixed-point servo trajectory generator (trapezoid and S-curve)
+ * 
+ * Traj_Move picks whole tick counts for each segment from the limits,
+ * then scales the jerk (or the acceleration for a trapezoid) so that
+ * the integration Traj_Step does lands on the target. Every move starts
+ * and ends at rest. Traj_Step only adds: acc += jerk, vel += acc,
+ * pos += vel, and moves to the next segment when its ticks run out.
+ * Rounding the scaled jerk leaves at most a count or two, the last step
+ * puts the position on the target. Tick counts are rounded so the scaled
+ * jerk never exceeds the one given, the limits hold.
+ * Distances are in counts below 65536 so dist << TRAJ_Q fits in 32 bits.
+ * 
+ * ========================================
+*/
+#include <project.h>
+#include "trajectory.h"
+
+/* Integer square root, rounded up */
+static uint32 SqrtCeil(uint32 x)
+{
+    uint32 r = 0u, bit = 1uL << 30;
+
+    while (bit > x) bit >>= 2;
+    while (bit)
+    {
+        if (x >= r + bit)
+        {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        }
+        else r >>= 1;
+        bit >>= 2;
+    }
+    return x ? r + 1u : r;
+}
+/* a / b rounded up, b > 0 */
+static uint32 DivCeil(uint32 a, uint32 b)
+{
+    return (a + b - 1u) / b;
+}
+/* Distance the integrator covers for the segments with the jerk (or
+ * acceleration) scaled to 1 */
+static int64 UnitDistance(const TrajSegment *s, uint8 n)
+{
+    int64 pos = 0, vel = 0, acc;
+    uint16 k;
+
+    for (; n; n--, s++)
+    {
+        acc = s->acc;
+        for (k = 0u; k < s->ticks; k++)
+        {
+            acc += s->jerk;
+            vel += acc;
+            pos += vel;
+        }
+    }
+    return pos;
+}
+/* Trapezoid: accelerate Ta, cruise Tv, decelerate Ta ticks.
+ * Accelerating to a * Ta and back covers a * Ta^2 in whole ticks. */
+static uint8 PlanTrapezoid(const Traj *t, uint32 dist, TrajSegment *s)
+{
+    uint32 v = (uint32)t->vmax, a = (uint32)t->amax;
+    uint32 ta, tv = 0u;
+    /* Distance accelerating to the peak and back, in counts */
+    uint32 dAcc;
+
+    /* Round down so a * Ta stays under v */
+    ta = v / a;
+    if (ta == 0u) ta = 1u;
+    dAcc = (uint32)(((uint64)a * ta * ta) >> TRAJ_Q);
+    if (dAcc >= dist) ta = SqrtCeil((dist << TRAJ_Q) / a);
+    else tv = DivCeil((dist - dAcc) << TRAJ_Q, a * ta);
+    if (ta == 0u) ta = 1u;
+
+    s[0].ticks = (uint16)ta; s[0].acc = 1;  s[0].jerk = 0;
+    s[1].ticks = (uint16)tv; s[1].acc = 0;  s[1].jerk = 0;
+    s[2].ticks = (uint16)ta; s[2].acc = -1; s[2].jerk = 0;
+    return 3u;
+}
+/* S-curve segments: jerk Tj, constant acceleration Ta, jerk Tj,
+ * cruise Tv and the mirror image to stop, with unit jerk */
+static void SCurveSegments(TrajSegment *s, uint32 tj, uint32 ta, uint32 tv)
+{
+    s[0].ticks = (uint16)tj; s[0].acc = 0;           s[0].jerk = 1;
+    s[1].ticks = (uint16)ta; s[1].acc = (int32)tj;   s[1].jerk = 0;
+    s[2].ticks = (uint16)tj; s[2].acc = (int32)tj;   s[2].jerk = -1;
+    s[3].ticks = (uint16)tv; s[3].acc = 0;           s[3].jerk = 0;
+    s[4].ticks = (uint16)tj; s[4].acc = 0;           s[4].jerk = -1;
+    s[5].ticks = (uint16)ta; s[5].acc = -(int32)tj;  s[5].jerk = 0;
+    s[6].ticks = (uint16)tj; s[6].acc = -(int32)tj;  s[6].jerk = 1;
+}
+/* S-curve: the peak acceleration is j * Tj and the peak velocity
+ * j * Tj * (Tj + Ta), both rounded down to stay within the limits */
+static uint8 PlanSCurve(const Traj *t, uint32 dist, TrajSegment *s)
+{
+    uint32 v = (uint32)t->vmax, a = (uint32)t->amax, j = (uint32)t->jmax;
+    uint32 tj, ta, tv = 0u, vPeak, dAcc;
+
+    tj = a / j;
+    if (tj == 0u) tj = 1u;
+    ta = v / (j * tj);
+    if (ta >= tj) ta -= tj;
+    else
+    {
+        /* v is reached before a, no constant acceleration */
+        tj = SqrtCeil(v / j + 1u) - 1u;
+        if (tj == 0u) tj = 1u;
+        ta = 0u;
+    }
+    /* Shrink the ramps until accelerating and stopping fit in dist */
+    for (;;)
+    {
+        SCurveSegments(s, tj, ta, 0u);
+        dAcc = (uint32)((UnitDistance(s, 7u) * j) >> TRAJ_Q);
+        if (dAcc <= dist) break;
+        if (ta) ta--;
+        else if (tj > 1u) tj--;
+        else break;
+    }
+    vPeak = j * tj * (tj + ta);
+    if (dAcc < dist) tv = DivCeil((dist - dAcc) << TRAJ_Q, vPeak);
+    SCurveSegments(s, tj, ta, tv);
+    return 7u;
+}
+
+/* Subprocesses */
+/* Set the limits (Q16 per tick, see TRAJ_VEL) and the start position */
+void Traj_Init(Traj *t, uint16 pos, uint8 profile, int32 vmax, int32 amax, int32 jmax)
+{
+    t->profile = profile;
+    t->vmax = vmax > 0 ? vmax : 1;
+    t->amax = amax > 0 ? amax : 1;
+    t->jmax = jmax > 0 ? jmax : 1;
+    t->pos = (int32)pos << TRAJ_Q;
+    t->target = t->pos;
+    t->vel = 0;
+    t->acc = 0;
+    t->jerk = 0;
+    t->segCount = 0u;
+    t->segIndex = 0u;
+    t->left = 0u;
+}
+/* Plan a move from the current position to target and start it.
+ * Runs in the main loop, the step interrupt only sees the finished plan.
+ * Return the length of the move in ticks. */
+uint16 Traj_Move(Traj *t, uint16 target)
+{
+    TrajSegment s[TRAJ_MAX_SEGMENTS];
+    int32 from = Traj_Position(t);
+    int32 d = (int32)target - from;
+    uint32 dist = (uint32)(d < 0 ? -d : d);
+    int64 unit;
+    int32 scale;
+    uint16 ticks = 0u;
+    uint8 n = 0u, i, intState;
+
+    if (dist != 0u)
+    {
+        n = (t->profile == TRAJ_SCURVE) ? PlanSCurve(t, dist, s) : PlanTrapezoid(t, dist, s);
+        /* Scale the unit jerk so the steps add up to the distance */
+        unit = UnitDistance(s, n);
+        scale = (int32)((((int64)dist << TRAJ_Q) + unit / 2) / unit);
+        if (d < 0) scale = -scale;
+        for (i = 0u; i < n; i++)
+        {
+            s[i].acc *= scale;
+            s[i].jerk *= scale;
+            ticks += s[i].ticks;
+        }
+    }
+
+    intState = CyEnterCriticalSection();
+    for (i = 0u; i < n; i++) t->seg[i] = s[i];
+    t->segCount = n;
+    t->segIndex = 0u;
+    t->left = n ? s[0].ticks : 0u;
+    t->acc = n ? s[0].acc : 0;
+    t->jerk = n ? s[0].jerk : 0;
+    t->vel = 0;
+    t->pos = from << TRAJ_Q;
+    t->target = (int32)target << TRAJ_Q;
+    /* Skip empty segments at the start */
+    while (t->segIndex < t->segCount && t->left == 0u)
+    {
+        if (++t->segIndex < t->segCount)
+        {
+            t->left = t->seg[t->segIndex].ticks;
+            t->acc = t->seg[t->segIndex].acc;
+            t->jerk = t->seg[t->segIndex].jerk;
+        }
+    }
+    if (Traj_Done(t)) t->pos = t->target;
+    CyExitCriticalSection(intState);
+    return ticks;
+}
+/* Advance one tick and return the compare value, called every PWM period */
+uint16 Traj_Step(Traj *t)
+{
+    const TrajSegment *s;
+
+    if (Traj_Done(t)) return Traj_Position(t);
+    t->acc += t->jerk;
+    t->vel += t->acc;
+    t->pos += t->vel;
+    if (--t->left == 0u)
+    {
+        /* Next segment that has ticks */
+        while (++t->segIndex < t->segCount)
+        {
+            s = &t->seg[t->segIndex];
+            if (s->ticks)
+            {
+                t->left = s->ticks;
+                t->acc = s->acc;
+                t->jerk = s->jerk;
+                break;
+            }
+        }
+        if (Traj_Done(t))
+        {
+            t->pos = t->target;
+            t->vel = 0;
+        }
+    }
+    return Traj_Position(t);
+}
+
+/* [] END OF FILE */
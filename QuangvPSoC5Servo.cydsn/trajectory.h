@@ -0,0 +1,73 @@
+/* ========================================
+ *
+ * Copyright Quang Minh Vu Metropolia UAS
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CC - BY - SA 4.0
+ *   
+ * PSoC fundamentals Exercise 2
+ * Fixed-point servo trajectory generator (trapezoid and S-curve)
+ * 
+ * ========================================
+*/
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "cytypes.h"
+
+/* One step per PWM period (20 ms) */
+#define TRAJ_TICK_HZ        50
+/* Position, velocity, acceleration and jerk are Q16 compare counts
+ * per tick, per tick^2 and per tick^3 */
+#define TRAJ_Q              16
+#define TRAJ_VEL(cps)       ((int32)((cps) * 65536.0 / TRAJ_TICK_HZ))
+#define TRAJ_ACC(cps2)      ((int32)((cps2) * 65536.0 / TRAJ_TICK_HZ / TRAJ_TICK_HZ))
+#define TRAJ_JERK(cps3)     ((int32)((cps3) * 65536.0 / TRAJ_TICK_HZ / TRAJ_TICK_HZ / TRAJ_TICK_HZ))
+
+/* Profiles */
+#define TRAJ_TRAPEZOID      0   /* velocity and acceleration limited */
+#define TRAJ_SCURVE         1   /* jerk limited as well */
+
+#define TRAJ_MAX_SEGMENTS   7
+
+/* Constant jerk segment, acc is the acceleration on entry */
+typedef struct
+{
+    uint16 ticks;
+    int32 acc;
+    int32 jerk;
+} TrajSegment;
+
+typedef struct
+{
+    /* Limits, set by Traj_Init */
+    uint8 profile;
+    int32 vmax;
+    int32 amax;
+    int32 jmax;
+    /* Move in progress, written by Traj_Move */
+    TrajSegment seg[TRAJ_MAX_SEGMENTS];
+    uint8 segCount;
+    int32 target;
+    /* Integrator, advanced by Traj_Step */
+    uint8 segIndex;
+    uint16 left;
+    int32 pos;
+    int32 vel;
+    int32 acc;
+    int32 jerk;
+} Traj;
+
+void Traj_Init(Traj *t, uint16 pos, uint8 profile, int32 vmax, int32 amax, int32 jmax);
+uint16 Traj_Move(Traj *t, uint16 target);
+uint16 Traj_Step(Traj *t);
+
+/* Nonzero once the last move has ended */
+#define Traj_Done(t)        ((t)->segIndex >= (t)->segCount)
+/* Position in compare counts */
+#define Traj_Position(t)    ((uint16)(((t)->pos + (1L << (TRAJ_Q - 1))) >> TRAJ_Q))
+
+#endif /* TRAJECTORY_H */
+
+/* [] END OF FILE */